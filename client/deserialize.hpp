@@ -10,46 +10,46 @@ struct CouldNotDeserialize : public std::exception {
 
 // TCP
 
-template <typename T> T deserialize(TCPReader &tcp_reader);
+template <typename T> T deserialize(Reader &reader);
 
-std::string deserialize_string(TCPReader &tcp_reader);
+std::string deserialize_string(Reader &reader);
 
-template <typename T> std::vector<T> deserialize_vector(TCPReader &tcp_reader);
+template <typename T> std::vector<T> deserialize_vector(Reader &reader);
 
 template <typename K, typename V>
-std::map<K, V> deserialize_map(TCPReader &tcp_reader);
+std::map<K, V> deserialize_map(Reader &reader);
 
-Position deserialize_position(TCPReader &tcp_reader);
+Position deserialize_position(Reader &reader);
 
-Bomb deserialize_bomb(TCPReader &tcp_reader);
+Bomb deserialize_bomb(Reader &reader);
 
-Player deserialize_player(TCPReader &tcp_reader);
+Player deserialize_player(Reader &reader);
 
-Join deserialize_join(TCPReader &tcp_reader);
+Join deserialize_join(Reader &reader);
 
-ClientMessage deserialize_client_message(TCPReader &tcp_reader);
+ClientMessage deserialize_client_message(Reader &reader);
 
-BombPlaced deserialize_bomb_placed(TCPReader &tcp_reader);
+BombPlaced deserialize_bomb_placed(Reader &reader);
 
-BombExploded deserialize_bomb_exploded(TCPReader &tcp_reader);
+BombExploded deserialize_bomb_exploded(Reader &reader);
 
-PlayerMoved deserialize_player_moved(TCPReader &tcp_reader);
+PlayerMoved deserialize_player_moved(Reader &reader);
 
-BlockPlaced deserialize_block_placed(TCPReader &tcp_reader);
+BlockPlaced deserialize_block_placed(Reader &reader);
 
-Event deserialize_event(TCPReader &tcp_reader);
+Event deserialize_event(Reader &reader);
 
-Hello deserialize_hello(TCPReader &tcp_reader);
+Hello deserialize_hello(Reader &reader);
 
-AcceptedPlayer deserialize_accepted_player(TCPReader &tcp_reader);
+AcceptedPlayer deserialize_accepted_player(Reader &reader);
 
-GameStarted deserialize_game_started(TCPReader &tcp_reader);
+GameStarted deserialize_game_started(Reader &reader);
 
-Turn deserialize_turn(TCPReader &tcp_reader);
+Turn deserialize_turn(Reader &reader);
 
-GameEnded deserialize_game_ended(TCPReader &tcp_reader);
+GameEnded deserialize_game_ended(Reader &reader);
 
-ServerMessage deserialize_server_message(TCPReader &tcp_reader);
+ServerMessage deserialize_server_message(Reader &reader);
 
 // UDP
 
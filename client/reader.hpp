@@ -0,0 +1,51 @@
+#ifndef __READER_HPP
+#define __READER_HPP
+
+#include <exception>
+
+#include "messages.hpp"
+
+struct InvalidTCPMessage : public std::exception {
+  const char *what() const throw() { return "InvalidTCPMessage"; }
+};
+
+// A source of bytes of a TCP stream.
+class Reader {
+public:
+  virtual ~Reader() = default;
+
+  // returns exactly cnt bytes or throws InvalidTCPMessage
+  virtual message_t read(size_t cnt) = 0;
+};
+
+// Reads bytes that are already in memory, e.g. the part of a stream received
+// so far.
+class BufferReader : public Reader {
+public:
+  BufferReader(const uint8_t *data_, size_t size_) : data(data_), size(size_) {}
+
+  message_t read(size_t cnt) override {
+    if (cnt > size - pos) {
+      exhausted = true;
+      throw InvalidTCPMessage();
+    }
+    message_t ret(data + pos, data + pos + cnt);
+    pos += cnt;
+    return ret;
+  }
+
+  // number of bytes read so far
+  size_t position() const { return pos; }
+
+  // whether a read failed because the buffer ended, i.e. more bytes of the
+  // stream are needed
+  bool is_exhausted() const { return exhausted; }
+
+private:
+  const uint8_t *data;
+  size_t size;
+  size_t pos = 0;
+  bool exhausted = false;
+};
+
+#endif // __READER_HPP
@@ -5,6 +5,7 @@
 #include "deserialize.hpp"
 #include "messages.hpp"
 #include "serialize.hpp"
+#include "timing_wheel.hpp"
 
 using boost::asio::ip::tcp;
 using boost::asio::ip::udp;
@@ -121,11 +122,13 @@ int main(int argc, char **argv) {
   std::vector<Bomb> bombs;
   std::set<Position> explosions;
   std::map<PlayerId, Score> scores;
-  std::map<BombId, Bomb> ticking_bombs;
+  TimingWheel<BombId, Position> ticking_bombs;
 
+  // reused, so that the drawn states are encoded without allocating
+  message_t gui_message;
   for (;;) {
     try {
-      message_t gui_message;
+      gui_message.clear();
 
       auto make_lobby = [&] {
         Lobby lobby;
@@ -137,7 +140,7 @@ int main(int argc, char **argv) {
         lobby.explosion_radius = hello.explosion_radius;
         lobby.bomb_timer = hello.bomb_timer;
         lobby.players = players;
-        gui_message = serialize(DrawMessage{lobby});
+        encode(gui_message, lobby);
       };
       auto make_game = [&] {
         Game game;
@@ -153,13 +156,14 @@ int main(int argc, char **argv) {
         game.explosions =
             std::vector<Position>(explosions.begin(), explosions.end());
         game.scores = scores;
-        gui_message = serialize(DrawMessage{game});
+        encode(gui_message, game);
       };
 
       auto server_message = deserialize_server_message(tcp_reader);
 
       if (std::holds_alternative<Hello>(server_message.m)) {
         hello = get<Hello>(server_message.m);
+        ticking_bombs = TimingWheel<BombId, Position>(hello.bomb_timer);
         make_lobby();
       } else if (std::holds_alternative<AcceptedPlayer>(server_message.m)) {
         auto accepted_player = get<AcceptedPlayer>(server_message.m);
@@ -179,17 +183,21 @@ int main(int argc, char **argv) {
         game_turn = turn.turn;
         std::set<PlayerId> exploded_players;
         explosions.clear();
-        for (auto &[_bomb_id, bomb] : ticking_bombs)
-          --bomb.timer;
+        auto expired_bombs = ticking_bombs.advance();
+        std::map<BombId, Position> exploding_bombs(expired_bombs.begin(),
+                                                   expired_bombs.end());
         for (const auto &event : turn.events) {
           if (std::holds_alternative<BombPlaced>(event.m)) {
             auto bomb_placed = get<BombPlaced>(event.m);
-            ticking_bombs[bomb_placed.id] =
-                Bomb{bomb_placed.position, hello.bomb_timer};
+            ticking_bombs.schedule(bomb_placed.id, bomb_placed.position);
           } else if (std::holds_alternative<BombExploded>(event.m)) {
             auto bomb_exploded = get<BombExploded>(event.m);
 
-            auto position = ticking_bombs[bomb_exploded.id].position;
+            Position position{};
+            if (exploding_bombs.contains(bomb_exploded.id))
+              position = exploding_bombs[bomb_exploded.id];
+            else if (ticking_bombs.contains(bomb_exploded.id))
+              position = ticking_bombs.at(bomb_exploded.id);
             auto is_legal = [&](int x, int y) {
               return x >= 0 && x < hello.size_x && y >= 0 && y < hello.size_y;
             };
@@ -225,8 +233,10 @@ int main(int argc, char **argv) {
         for (const auto &player_id : exploded_players)
           ++scores[player_id];
         bombs.clear();
-        for (const auto &[_bomb_id, bomb] : ticking_bombs)
-          bombs.emplace_back(bomb);
+        ticking_bombs.for_each(
+            [&](BombId, const Position &position, uint16_t timer) {
+              bombs.emplace_back(Bomb{position, timer});
+            });
 
         make_game();
       } else { // GameEnded
@@ -6,16 +6,13 @@
 #include <queue>
 
 #include "messages.hpp"
+#include "reader.hpp"
 
-struct InvalidTCPMessage : public std::exception {
-  const char *what() const throw() { return "InvalidTCPMessage"; }
-};
-
-class TCPReader {
+class TCPReader : public Reader {
 public:
   TCPReader(boost::asio::ip::tcp::socket &socket_) : socket(socket_) {}
 
-  message_t read(size_t cnt) {
+  message_t read(size_t cnt) override {
     message_t ret;
     transfer(ret, cnt);
     while (ret.size() < cnt) {
@@ -0,0 +1,80 @@
+#ifndef __TIMING_WHEEL_HPP
+#define __TIMING_WHEEL_HPP
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Values that expire a fixed number of turns after being scheduled (like
+// bombs). The wheel has a bucket per due turn, so advancing to the next turn
+// only touches the values that expire in it.
+template <typename K, typename V> class TimingWheel {
+public:
+  TimingWheel() : TimingWheel(1) {}
+
+  // a timer of 0 behaves like a uint16_t countdown that wraps around, i.e.
+  // it expires after 2^16 turns
+  explicit TimingWheel(uint16_t timer)
+      : delay(timer == 0 ? size_t(1) << 16 : timer), buckets(delay) {}
+
+  void schedule(const K &key, const V &value) {
+    entries[key] = {value, now + delay};
+    buckets[(now + delay) % delay].emplace_back(key);
+  }
+
+  // moves to the next turn and returns the values expiring in it, in the
+  // order in which they were scheduled
+  std::vector<std::pair<K, V>> advance() {
+    ++now;
+    std::vector<std::pair<K, V>> ret;
+    auto &bucket = buckets[now % delay];
+    for (const auto &key : bucket) {
+      auto it = entries.find(key);
+      if (it != entries.end() && it->second.due == now) {
+        ret.emplace_back(key, it->second.value);
+        entries.erase(it);
+      }
+    }
+    bucket.clear();
+    return ret;
+  }
+
+  bool contains(const K &key) const { return entries.contains(key); }
+
+  const V &at(const K &key) const { return entries.at(key).value; }
+
+  // number of turns left until the value expires
+  uint16_t timer(const K &key) const {
+    return uint16_t(entries.at(key).due - now);
+  }
+
+  void erase(const K &key) { entries.erase(key); }
+
+  // calls f(key, value, timer) for every scheduled value, in key order
+  template <typename F> void for_each(F f) const {
+    for (const auto &[key, entry] : entries)
+      f(key, entry.value, uint16_t(entry.due - now));
+  }
+
+  size_t size() const { return entries.size(); }
+
+  void clear() {
+    now = 0;
+    entries.clear();
+    for (auto &bucket : buckets)
+      bucket.clear();
+  }
+
+private:
+  struct Entry {
+    V value;
+    uint64_t due;
+  };
+
+  size_t delay;
+  uint64_t now = 0;
+  std::vector<std::vector<K>> buckets;
+  std::map<K, Entry> entries;
+};
+
+#endif // __TIMING_WHEEL_HPP
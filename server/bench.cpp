@@ -0,0 +1,491 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <set>
+#include <thread>
+#include <type_traits>
+
+#include "board.hpp"
+#include "deserialize.hpp"
+#include "explosion.hpp"
+#include "game_engine.hpp"
+#include "messages.hpp"
+#include "reader.hpp"
+#include "serialize.hpp"
+#include "turn_pool.hpp"
+
+namespace {
+
+// every benchmark is run this many times with fresh inputs, the results are
+// the fastest and the median run
+constexpr int REPETITIONS = 7;
+
+// keeps the compiler from dropping the benchmarked code
+volatile size_t sink;
+
+struct Result {
+  std::string name;
+  size_t iterations;
+  double min_ns;
+  double median_ns;
+  // size of the processed message or of the blocks of the game state, if any
+  size_t bytes = 0;
+};
+
+// Runs run(context) iterations times on a context made by setup() before
+// every repetition, so that the setup is not measured.
+template <typename Setup, typename Run>
+Result measure(const std::string &name, size_t iterations, Setup setup,
+               Run run) {
+  std::vector<double> times;
+  for (int repetition = 0; repetition < REPETITIONS; ++repetition) {
+    auto context = setup();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+      sink = sink + run(context);
+    auto end = std::chrono::steady_clock::now();
+    times.emplace_back(
+        std::chrono::duration<double, std::nano>(end - start).count() /
+        double(iterations));
+  }
+  std::sort(times.begin(), times.end());
+  return {name, iterations, times.front(), times[times.size() / 2]};
+}
+
+void print_json(const std::vector<Result> &results) {
+  std::cout << "{\n  \"repetitions\": " << REPETITIONS
+            << ",\n  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto &result = results[i];
+    std::cout << "    {\"name\": \"" << result.name
+              << "\", \"iterations\": " << result.iterations
+              << ", \"min_ns\": " << result.min_ns
+              << ", \"median_ns\": " << result.median_ns
+              << ", \"bytes\": " << result.bytes << "}"
+              << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  std::cout << "  ]\n}" << std::endl;
+}
+
+// block containers
+
+constexpr int BLOCK_PLAYERS = 255;
+constexpr int BLOCK_BOMBS = 1000;
+constexpr uint16_t BLOCK_EXPLOSION_RADIUS = 32;
+
+// Replays the block-related work of a server turn (explosion rays, move
+// checks and block changes) on the given blocks container.
+template <typename Blocks>
+size_t block_turn(Blocks &blocks, uint16_t size_x, uint16_t size_y,
+                  std::minstd_rand &random) {
+  auto generate_position = [&] {
+    return Position{uint16_t(random() % size_x), uint16_t(random() % size_y)};
+  };
+  auto is_legal = [&](int x, int y) {
+    return x >= 0 && x < size_x && y >= 0 && y < size_y;
+  };
+
+  std::vector<Position> bombs(BLOCK_BOMBS);
+  std::vector<Position> players(BLOCK_PLAYERS);
+  size_t checksum = 0;
+  for (auto &bomb : bombs)
+    bomb = generate_position();
+  for (auto &player : players)
+    player = generate_position();
+
+  std::vector<Position> exploded_blocks;
+  std::vector<Position> blocks_to_be_placed;
+  for (const auto &bomb : bombs) {
+    for (auto [dx, dy] : std::vector<std::pair<int, int>>{
+             {1, 0}, {-1, 0}, {0, 1}, {0, -1}}) {
+      for (int i = 0; i <= BLOCK_EXPLOSION_RADIUS; ++i) {
+        int x = bomb.x + i * dx;
+        int y = bomb.y + i * dy;
+        if (!is_legal(x, y))
+          break;
+        Position position = {uint16_t(x), uint16_t(y)};
+        if (blocks.contains(position)) {
+          exploded_blocks.emplace_back(position);
+          break;
+        }
+      }
+    }
+  }
+  for (const auto &player : players) {
+    auto [x, y] = player.move(Direction(random() % 4));
+    if (is_legal(x, y) && !blocks.contains({uint16_t(x), uint16_t(y)}))
+      ++checksum;
+    if (!blocks.contains(player))
+      blocks_to_be_placed.emplace_back(player);
+  }
+  for (const auto &block : exploded_blocks)
+    blocks.erase(block);
+  for (const auto &block : blocks_to_be_placed)
+    blocks.emplace(block);
+  return checksum;
+}
+
+template <typename Blocks>
+void fill(Blocks &blocks, uint16_t size_x, uint16_t size_y, uint32_t seed) {
+  std::minstd_rand random(seed);
+  size_t count = size_t(size_x) * size_y / 4;
+  for (size_t i = 0; i < count; ++i)
+    blocks.emplace(
+        Position{uint16_t(random() % size_x), uint16_t(random() % size_y)});
+}
+
+// the blocks carry over between repetitions, filling them is too slow
+template <typename Blocks>
+Result measure_blocks(const std::string &name, uint16_t size) {
+  Blocks blocks = [&] {
+    if constexpr (std::is_same_v<Blocks, Board>)
+      return Board(size, size);
+    else
+      return Blocks();
+  }();
+  fill(blocks, size, size, 1);
+  return measure(
+      name + "/" + std::to_string(size) + "x" + std::to_string(size), 20,
+      [] { return std::minstd_rand(2); },
+      [&](std::minstd_rand &random) {
+        return block_turn(blocks, size, size, random);
+      });
+}
+
+// explosion rays
+
+constexpr uint16_t RAY_BOARD_SIZE = 4096;
+constexpr double RAY_BLOCK_DENSITY = 0.0005;
+constexpr size_t RAY_BOMBS = 1024;
+
+// the per-cell loop the engine used before the ray kernels
+std::array<Ray, 4> cast_explosion_loop(const Bitboard &blocks,
+                                       const Position &bomb, uint16_t radius,
+                                       uint16_t size_x, uint16_t size_y) {
+  std::array<Ray, 4> ret = {Ray{Right, 0, false}, Ray{Left, 0, false},
+                            Ray{Up, 0, false}, Ray{Down, 0, false}};
+  std::array<std::pair<int, int>, 4> steps = {
+      {{1, 0}, {-1, 0}, {0, 1}, {0, -1}}};
+  for (size_t d = 0; d < ret.size(); ++d) {
+    auto [dx, dy] = steps[d];
+    for (int i = 0; i <= radius; ++i) {
+      int x = bomb.x + i * dx;
+      int y = bomb.y + i * dy;
+      if (x < 0 || x >= size_x || y < 0 || y >= size_y)
+        break;
+      ret[d].reach = uint16_t(i);
+      if (blocks.contains({uint16_t(x), uint16_t(y)})) {
+        ret[d].blocked = true;
+        break;
+      }
+    }
+  }
+  return ret;
+}
+
+template <typename Cast>
+Result measure_rays(const std::string &name, const Bitboard &blocks,
+                    uint16_t radius, Cast cast) {
+  return measure(
+      name + "/" + std::to_string(radius), 20,
+      [] { return std::minstd_rand(3); },
+      [&](std::minstd_rand &random) {
+        size_t checksum = 0;
+        for (size_t i = 0; i < RAY_BOMBS; ++i) {
+          Position bomb{uint16_t(random() % RAY_BOARD_SIZE),
+                        uint16_t(random() % RAY_BOARD_SIZE)};
+          for (const auto &ray : cast(blocks, bomb, radius))
+            checksum += size_t(ray.reach) * 2 + ray.blocked;
+        }
+        return checksum;
+      });
+}
+
+// game states
+
+struct Scenario {
+  std::string name;
+  uint16_t size;
+  uint16_t explosion_radius;
+  // fraction of the cells with a block
+  double density;
+  size_t bombs;
+};
+
+ServerOptions scenario_options(const Scenario &scenario) {
+  ServerOptions options{};
+  options.bomb_timer = 1;
+  options.players_count = 255;
+  options.explosion_radius = scenario.explosion_radius;
+  options.initial_blocks = 0;
+  options.game_length = 65535;
+  options.size_x = scenario.size;
+  options.size_y = scenario.size;
+  return options;
+}
+
+// a state in which all the bombs explode in the next turn
+GameState scenario_state(const Scenario &scenario, const GameEngine &engine,
+                         const ServerOptions &options) {
+  GameState state(options, 1);
+  engine.start(state);
+  std::minstd_rand random(3);
+  auto generate_position = [&] {
+    return Position{uint16_t(random() % scenario.size),
+                    uint16_t(random() % scenario.size)};
+  };
+  auto blocks =
+      size_t(double(scenario.size) * scenario.size * scenario.density);
+  for (size_t i = 0; i < blocks; ++i)
+    state.blocks.emplace(generate_position());
+  for (size_t i = 0; i < scenario.bombs; ++i)
+    state.ticking_bombs.schedule(BombId(i), generate_position());
+  state.next_bomb_id = BombId(scenario.bombs);
+  return state;
+}
+
+// every player does something
+Inputs scenario_inputs(uint16_t players_count) {
+  std::minstd_rand random(4);
+  Inputs inputs(players_count);
+  for (auto &input : inputs) {
+    switch (random() % 3) {
+    case 0:
+      input = ClientMessage{PlaceBomb{}};
+      break;
+    case 1:
+      input = ClientMessage{PlaceBlock{}};
+      break;
+    default:
+      input = ClientMessage{Move{Direction(random() % 4)}};
+    }
+  }
+  return inputs;
+}
+
+GameStarted largest_game_started() {
+  GameStarted game_started;
+  for (int i = 0; i < 255; ++i) {
+    Player player;
+    player.name = std::string(255, 'a');
+    player.address = "[0000:0000:0000:0000:0000:0000:0000:0000]:65535";
+    game_started.players[PlayerId(i)] = player;
+  }
+  return game_started;
+}
+
+// the state of a crowded game as the client draws it
+Game largest_game() {
+  Game game;
+  game.server_name = std::string(255, 'a');
+  game.size_x = game.size_y = 1024;
+  game.game_length = 65535;
+  game.players = largest_game_started().players;
+  std::minstd_rand random(1);
+  auto position = [&] {
+    return Position{uint16_t(random() % 1024), uint16_t(random() % 1024)};
+  };
+  for (const auto &[id, _player] : game.players) {
+    game.player_positions[id] = position();
+    game.scores[id] = Score(random() % 1000);
+  }
+  for (int i = 0; i < 10000; ++i)
+    game.blocks.emplace_back(position());
+  for (int i = 0; i < 1000; ++i)
+    game.bombs.emplace_back(Bomb{position(), uint16_t(random() % 100)});
+  for (int i = 0; i < 5000; ++i)
+    game.explosions.emplace_back(position());
+  return game;
+}
+
+// Encodes x into a new buffer every time, as the server does, and into a
+// reused one, as the client does. The encoding must be the serialized
+// message.
+template <typename T>
+void measure_encode(std::vector<Result> &results, const std::string &name,
+                    const T &x, const message_t &serialized,
+                    size_t iterations) {
+  message_t reused;
+  encode(reused, x);
+  if (reused != serialized) {
+    std::cerr << "The encoding of " << name << " differs from serialize"
+              << std::endl;
+    exit(1);
+  }
+  results.emplace_back(measure(
+      "encode/" + name, iterations, [] { return 0; },
+      [&](int) {
+        message_t message;
+        encode(message, x);
+        return message.size();
+      }));
+  results.back().bytes = serialized.size();
+  results.emplace_back(measure(
+      "encode_reused/" + name, iterations, [] { return 0; },
+      [&](int) {
+        encode(reused, x);
+        return reused.size();
+      }));
+  results.back().bytes = serialized.size();
+}
+
+Result measure_deserialize_server_message(const std::string &name,
+                                          const message_t &message,
+                                          size_t iterations) {
+  auto result = measure(
+      name, iterations, [] { return 0; },
+      [&](int) {
+        BufferReader reader(message.data(), message.size());
+        deserialize_server_message(reader);
+        return reader.position();
+      });
+  result.bytes = message.size();
+  return result;
+}
+
+} // namespace
+
+int main() {
+  std::vector<Result> results;
+
+  for (int side : {64, 256, 1024, 4096}) {
+    auto size = uint16_t(side);
+    results.emplace_back(
+        measure_blocks<std::set<Position>>("blocks/set", size));
+    results.emplace_back(measure_blocks<Board>("blocks/board", size));
+  }
+
+  {
+    Bitboard blocks(RAY_BOARD_SIZE, RAY_BOARD_SIZE);
+    std::minstd_rand random(1);
+    auto count = size_t(double(RAY_BOARD_SIZE) * RAY_BOARD_SIZE *
+                        RAY_BLOCK_DENSITY);
+    for (size_t i = 0; i < count; ++i)
+      blocks.emplace(Position{uint16_t(random() % RAY_BOARD_SIZE),
+                              uint16_t(random() % RAY_BOARD_SIZE)});
+    std::vector<std::pair<std::string, RayKernel>> kernels = {
+        {"scalar", RayKernel::Scalar}};
+    if (best_ray_kernel() == RayKernel::Avx2)
+      kernels.emplace_back("avx2", RayKernel::Avx2);
+    for (int r : {1, 10, 100, 1000}) {
+      auto radius = uint16_t(r);
+      results.emplace_back(measure_rays(
+          "rays/loop", blocks, radius,
+          [](const Bitboard &blocks, const Position &bomb, uint16_t radius) {
+            return cast_explosion_loop(blocks, bomb, radius, RAY_BOARD_SIZE,
+                                       RAY_BOARD_SIZE);
+          }));
+      for (const auto &[name, kernel] : kernels) {
+        results.emplace_back(measure_rays(
+            "rays/" + name, blocks, radius,
+            [kernel](const Bitboard &blocks, const Position &bomb,
+                     uint16_t radius) {
+              return cast_explosion(blocks, bomb, radius, RAY_BOARD_SIZE,
+                                    RAY_BOARD_SIZE, kernel);
+            }));
+      }
+    }
+  }
+
+  std::vector<Scenario> scenarios = {
+      {"dense", 256, 16, 0.5, 4096},
+      {"sparse_large_radius", 1024, 1000, 0.01, 4096},
+      {"large_board", 4096, 1000, 0.001, 8192},
+      {"max_board", 65535, 1000, 0.00001, 8192},
+  };
+  Turn largest_turn;
+  for (const auto &scenario : scenarios) {
+    auto options = scenario_options(scenario);
+    GameEngine engine(options);
+    auto state = scenario_state(scenario, engine, options);
+    auto inputs = scenario_inputs(options.players_count);
+    results.emplace_back(measure(
+        "step/" + scenario.name, 1, [&] { return state; },
+        [&](GameState &copy) {
+          auto turn = engine.step(copy, inputs);
+          if (turn.events.size() > largest_turn.events.size())
+            largest_turn = turn;
+          return turn.events.size();
+        }));
+    results.back().bytes = state.blocks.memory_usage();
+  }
+
+  // the same turns with the explosions split between 1 to N threads
+  auto max_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<unsigned> thread_counts;
+  for (unsigned threads = 1; threads < max_threads; threads *= 2)
+    thread_counts.emplace_back(threads);
+  thread_counts.emplace_back(max_threads);
+  for (const auto &scenario : scenarios) {
+    auto options = scenario_options(scenario);
+    auto state = scenario_state(scenario, GameEngine(options), options);
+    auto inputs = scenario_inputs(options.players_count);
+    for (auto threads : thread_counts) {
+      TurnPool turn_pool{uint16_t(threads)};
+      GameEngine engine(options, &turn_pool);
+      results.emplace_back(measure(
+          "step_threads/" + scenario.name + "/" + std::to_string(threads), 1,
+          [&] { return state; },
+          [&](GameState &copy) {
+            return engine.step(copy, inputs).events.size();
+          }));
+    }
+  }
+
+  auto turn_message = serialize(ServerMessage{largest_turn});
+  auto game_started = largest_game_started();
+  auto game_started_message = serialize(ServerMessage{game_started});
+  Hello hello{"robots", 255, 1024, 1024, 65535, 1000, 1};
+  auto hello_message = serialize(ServerMessage{hello});
+
+  results.emplace_back(measure(
+      "serialize/turn", 20, [] { return 0; },
+      [&](int) { return serialize(ServerMessage{largest_turn}).size(); }));
+  results.back().bytes = turn_message.size();
+  results.emplace_back(measure(
+      "serialize/game_started", 200, [] { return 0; },
+      [&](int) { return serialize(ServerMessage{game_started}).size(); }));
+  results.back().bytes = game_started_message.size();
+  results.emplace_back(measure(
+      "serialize/hello", 100000, [] { return 0; },
+      [&](int) { return serialize(ServerMessage{hello}).size(); }));
+  results.back().bytes = hello_message.size();
+  auto game = largest_game();
+  auto game_message = serialize(DrawMessage{game});
+  results.emplace_back(measure(
+      "serialize/game", 20, [] { return 0; },
+      [&](int) { return serialize(DrawMessage{game}).size(); }));
+  results.back().bytes = game_message.size();
+
+  measure_encode(results, "turn", largest_turn, turn_message, 20);
+  measure_encode(results, "game_started", game_started, game_started_message,
+                 200);
+  measure_encode(results, "hello", hello, hello_message, 100000);
+  measure_encode(results, "game", game, game_message, 20);
+
+  results.emplace_back(
+      measure_deserialize_server_message("deserialize/turn", turn_message, 20));
+  results.emplace_back(measure_deserialize_server_message(
+      "deserialize/game_started", game_started_message, 200));
+  results.emplace_back(measure_deserialize_server_message(
+      "deserialize/hello", hello_message, 100000));
+
+  std::vector<std::pair<std::string, ClientMessage>> client_messages = {
+      {"join", ClientMessage{Join{std::string(255, 'a')}}},
+      {"move", ClientMessage{Move{Left}}},
+  };
+  for (const auto &[name, client_message] : client_messages) {
+    auto message = serialize(client_message);
+    results.emplace_back(measure(
+        "deserialize_client/" + name, 1000000, [] { return 0; },
+        [&](int) {
+          BufferReader reader(message.data(), message.size());
+          deserialize_client_message(reader);
+          return reader.position();
+        }));
+    results.back().bytes = message.size();
+  }
+
+  print_json(results);
+}
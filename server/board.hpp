@@ -0,0 +1,197 @@
+#ifndef __BOARD_HPP
+#define __BOARD_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "messages.hpp"
+
+// A set of cells of a size_x * size_y board. The board is split into 64x64
+// chunks, each one a bitset with a row of cells per word, that are allocated
+// when their first cell is added and released for reuse when their last cell
+// is erased, so that the memory is proportional to the occupied area even on
+// a 65535x65535 board. A chunk is found with two array lookups, so every
+// operation is O(1).
+class Board {
+public:
+  static constexpr size_t CHUNK_SIZE = 64;
+  // the slot of the chunks without cells, its words are all 0
+  static constexpr uint32_t EMPTY_CHUNK = 0;
+
+  // the largest board
+  Board() : Board(UINT16_MAX, UINT16_MAX) {}
+
+  Board(uint16_t size_x, uint16_t size_y)
+      : chunks_x((size_t(size_x) + CHUNK_SIZE - 1) / CHUNK_SIZE),
+        chunk_rows((size_t(size_y) + CHUNK_SIZE - 1) / CHUNK_SIZE),
+        chunks(1), chunk_counts(1) {}
+
+  bool contains(const Position &position) const {
+    const auto &chunk_row = chunk_rows[position.y / CHUNK_SIZE];
+    if (chunk_row.empty())
+      return false;
+    const auto &chunk = chunks[chunk_row[position.x / CHUNK_SIZE]];
+    return (chunk[position.y % CHUNK_SIZE] >> (position.x % CHUNK_SIZE)) & 1;
+  }
+
+  void emplace(const Position &position) {
+    auto &chunk_row = chunk_rows[position.y / CHUNK_SIZE];
+    if (chunk_row.empty())
+      chunk_row.resize(chunks_x, EMPTY_CHUNK);
+    auto &slot = chunk_row[position.x / CHUNK_SIZE];
+    if (slot == EMPTY_CHUNK)
+      slot = allocate();
+    auto &row = chunks[slot][position.y % CHUNK_SIZE];
+    uint64_t bit = uint64_t(1) << (position.x % CHUNK_SIZE);
+    bool added = !(row & bit);
+    row |= bit;
+    chunk_counts[slot] += added;
+    count += added;
+  }
+
+  void erase(const Position &position) {
+    auto &chunk_row = chunk_rows[position.y / CHUNK_SIZE];
+    if (chunk_row.empty())
+      return;
+    auto &slot = chunk_row[position.x / CHUNK_SIZE];
+    if (slot == EMPTY_CHUNK)
+      return;
+    auto &row = chunks[slot][position.y % CHUNK_SIZE];
+    uint64_t bit = uint64_t(1) << (position.x % CHUNK_SIZE);
+    bool erased = row & bit;
+    row &= ~bit;
+    chunk_counts[slot] -= erased;
+    count -= erased;
+    // empty chunks are not kept
+    if (chunk_counts[slot] == 0) {
+      free_chunks.emplace_back(slot);
+      slot = EMPTY_CHUNK;
+    }
+  }
+
+  void clear() {
+    for (auto &chunk_row : chunk_rows)
+      std::vector<uint32_t>().swap(chunk_row);
+    std::vector<Chunk>(1).swap(chunks);
+    std::vector<uint32_t>(1).swap(chunk_counts);
+    std::vector<uint32_t>().swap(free_chunks);
+    count = 0;
+  }
+
+  size_t size() const { return count; }
+
+  // bytes allocated for the cells and the chunk directory
+  size_t memory_usage() const {
+    size_t ret = chunk_rows.capacity() * sizeof(chunk_rows[0]) +
+                 chunks.capacity() * sizeof(Chunk) +
+                 (chunk_counts.capacity() + free_chunks.capacity()) *
+                     sizeof(uint32_t);
+    for (const auto &chunk_row : chunk_rows)
+      ret += chunk_row.capacity() * sizeof(uint32_t);
+    return ret;
+  }
+
+  // calls f(position) for every cell in the set, in row-major order
+  template <typename F> void for_each(F f) const {
+    for (size_t chunk_y = 0; chunk_y < chunk_rows.size(); ++chunk_y) {
+      const auto &chunk_row = chunk_rows[chunk_y];
+      for (size_t y = 0; y < CHUNK_SIZE && !chunk_row.empty(); ++y) {
+        for (size_t chunk_x = 0; chunk_x < chunk_row.size(); ++chunk_x) {
+          for (uint64_t row = chunks[chunk_row[chunk_x]][y]; row;
+               row &= row - 1) {
+            f(Position{uint16_t(chunk_x * CHUNK_SIZE +
+                                size_t(__builtin_ctzll(row))),
+                       uint16_t(chunk_y * CHUNK_SIZE + y)});
+          }
+        }
+      }
+    }
+  }
+
+  // For the ray kernels: the slots of the chunks covering row y of cells,
+  // empty if none of them has a cell, and the words of all the chunks. Row
+  // y % CHUNK_SIZE of the chunk in a slot is the word at
+  // slot * CHUNK_SIZE + y % CHUNK_SIZE.
+  const std::vector<uint32_t> &row_slots(uint16_t y) const {
+    return chunk_rows[y / CHUNK_SIZE];
+  }
+  const uint64_t *words() const { return chunks[0].data(); }
+
+private:
+  using Chunk = std::array<uint64_t, CHUNK_SIZE>;
+
+  size_t chunks_x;
+  // the directory of the chunks, a row of slots per row of chunks allocated
+  // when needed; a slot holds the index of its chunk
+  std::vector<std::vector<uint32_t>> chunk_rows;
+  std::vector<Chunk> chunks;
+  std::vector<uint32_t> chunk_counts;
+  std::vector<uint32_t> free_chunks;
+  size_t count = 0;
+
+  // returns the slot of a new empty chunk
+  uint32_t allocate() {
+    if (!free_chunks.empty()) {
+      auto chunk = free_chunks.back();
+      free_chunks.pop_back();
+      return chunk;
+    }
+    chunks.emplace_back();
+    chunk_counts.emplace_back(0);
+    return uint32_t(chunks.size() - 1);
+  }
+};
+
+// A set of cells kept both as rows and as columns (a transposed copy), so
+// that rays in all four directions scan the cells 64 at a time.
+class Bitboard {
+public:
+  Bitboard() = default;
+
+  Bitboard(uint16_t size_x, uint16_t size_y)
+      : rows(size_x, size_y), columns(size_y, size_x) {}
+
+  bool contains(const Position &position) const {
+    return rows.contains(position);
+  }
+
+  void emplace(const Position &position) {
+    rows.emplace(position);
+    columns.emplace(transposed(position));
+  }
+
+  void erase(const Position &position) {
+    rows.erase(position);
+    columns.erase(transposed(position));
+  }
+
+  void clear() {
+    rows.clear();
+    columns.clear();
+  }
+
+  size_t size() const { return rows.size(); }
+
+  size_t memory_usage() const {
+    return rows.memory_usage() + columns.memory_usage();
+  }
+
+  // calls f(position) for every cell in the set, in row-major order
+  template <typename F> void for_each(F f) const { rows.for_each(f); }
+
+  // the cells of column x are the cells of row x of by_columns()
+  const Board &by_rows() const { return rows; }
+  const Board &by_columns() const { return columns; }
+
+private:
+  Board rows;
+  Board columns;
+
+  static Position transposed(const Position &position) {
+    return {position.y, position.x};
+  }
+};
+
+#endif // __BOARD_HPP
@@ -1,24 +1,24 @@
 #include "deserialize.hpp"
 
-template <typename T> T deserialize(TCPReader &tcp_reader) {
+template <typename T> T deserialize(Reader &reader) {
   if constexpr (std::integral<T>) {
-    return deserialize_integral<T>(tcp_reader);
+    return deserialize_integral<T>(reader);
   } else if constexpr (std::is_same<Position, T>()) {
-    return deserialize_position(tcp_reader);
+    return deserialize_position(reader);
   } else if constexpr (std::is_same<Bomb, T>()) {
-    return deserialize_bomb(tcp_reader);
+    return deserialize_bomb(reader);
   } else if constexpr (std::is_same<Event, T>()) {
-    return deserialize_event(tcp_reader);
+    return deserialize_event(reader);
   } else if constexpr (std::is_same<Player, T>()) {
-    return deserialize_player(tcp_reader);
+    return deserialize_player(reader);
   }
 }
 
-template <std::integral T> T deserialize_integral(TCPReader &tcp_reader) {
+template <std::integral T> T deserialize_integral(Reader &reader) {
   static constexpr int mod = (1 << 8);
   message_t message;
   try {
-    message = tcp_reader.read(sizeof(T));
+    message = reader.read(sizeof(T));
   } catch (const InvalidTCPMessage &) {
     throw CouldNotDeserialize();
   }
@@ -29,187 +29,187 @@ template <std::integral T> T deserialize_integral(TCPReader &tcp_reader) {
   return ret;
 }
 
-std::string deserialize_string(TCPReader &tcp_reader) {
-  auto len = deserialize<uint8_t>(tcp_reader);
+std::string deserialize_string(Reader &reader) {
+  auto len = deserialize<uint8_t>(reader);
   message_t message;
   try {
-    message = tcp_reader.read(len);
+    message = reader.read(len);
   } catch (const InvalidTCPMessage &) {
     throw CouldNotDeserialize();
   }
   return std::string(message.begin(), message.end());
 }
 
-template <typename T> std::vector<T> deserialize_vector(TCPReader &tcp_reader) {
-  auto len = deserialize<uint32_t>(tcp_reader);
+template <typename T> std::vector<T> deserialize_vector(Reader &reader) {
+  auto len = deserialize<uint32_t>(reader);
   std::vector<T> ret(len);
   for (uint32_t i = 0; i < len; ++i) {
-    ret[i] = deserialize<T>(tcp_reader);
+    ret[i] = deserialize<T>(reader);
   }
   return ret;
 }
 
 template <typename K, typename V>
-std::map<K, V> deserialize_map(TCPReader &tcp_reader) {
-  auto len = deserialize<uint32_t>(tcp_reader);
+std::map<K, V> deserialize_map(Reader &reader) {
+  auto len = deserialize<uint32_t>(reader);
   std::map<K, V> ret;
   for (uint32_t i = 0; i < len; ++i) {
-    auto key = deserialize<K>(tcp_reader);
-    auto value = deserialize<V>(tcp_reader);
+    auto key = deserialize<K>(reader);
+    auto value = deserialize<V>(reader);
     ret.emplace(key, value);
   }
   return ret;
 }
 
-Position deserialize_position(TCPReader &tcp_reader) {
+Position deserialize_position(Reader &reader) {
   Position ret;
-  ret.x = deserialize<uint16_t>(tcp_reader);
-  ret.y = deserialize<uint16_t>(tcp_reader);
+  ret.x = deserialize<uint16_t>(reader);
+  ret.y = deserialize<uint16_t>(reader);
   return ret;
 }
 
-Bomb deserialize_bomb(TCPReader &tcp_reader) {
+Bomb deserialize_bomb(Reader &reader) {
   Bomb ret;
-  ret.position = deserialize_position(tcp_reader);
-  ret.timer = deserialize<uint16_t>(tcp_reader);
+  ret.position = deserialize_position(reader);
+  ret.timer = deserialize<uint16_t>(reader);
   return ret;
 }
 
-Player deserialize_player(TCPReader &tcp_reader) {
+Player deserialize_player(Reader &reader) {
   Player ret;
-  ret.name = deserialize_string(tcp_reader);
-  ret.address = deserialize_string(tcp_reader);
+  ret.name = deserialize_string(reader);
+  ret.address = deserialize_string(reader);
   return ret;
 }
 
-Join deserialize_join(TCPReader &tcp_reader) {
+Join deserialize_join(Reader &reader) {
   Join ret;
-  ret.name = deserialize_string(tcp_reader);
+  ret.name = deserialize_string(reader);
   return ret;
 }
 
-Direction deserialize_direction(TCPReader &tcp_reader) {
-  auto type = deserialize<uint8_t>(tcp_reader);
+Direction deserialize_direction(Reader &reader) {
+  auto type = deserialize<uint8_t>(reader);
   if (type > 3) {
     throw CouldNotDeserialize();
   }
   return Direction(type);
 }
 
-Move deserialize_move(TCPReader &tcp_reader) {
+Move deserialize_move(Reader &reader) {
   Move ret;
-  ret.direction = deserialize_direction(tcp_reader);
+  ret.direction = deserialize_direction(reader);
   return ret;
 }
 
-ClientMessage deserialize_client_message(TCPReader &tcp_reader) {
-  auto type = deserialize<uint8_t>(tcp_reader);
+ClientMessage deserialize_client_message(Reader &reader) {
+  auto type = deserialize<uint8_t>(reader);
   if (type == 0) {
-    return ClientMessage{deserialize_join(tcp_reader)};
+    return ClientMessage{deserialize_join(reader)};
   } else if (type == 1) {
     return ClientMessage{PlaceBomb{}};
   } else if (type == 2) {
     return ClientMessage{PlaceBlock{}};
   } else if (type == 3) {
-    return ClientMessage{deserialize_move(tcp_reader)};
+    return ClientMessage{deserialize_move(reader)};
   } else {
     throw CouldNotDeserialize();
   }
 }
 
-BombPlaced deserialize_bomb_placed(TCPReader &tcp_reader) {
+BombPlaced deserialize_bomb_placed(Reader &reader) {
   BombPlaced ret;
-  ret.id = deserialize<BombId>(tcp_reader);
-  ret.position = deserialize_position(tcp_reader);
+  ret.id = deserialize<BombId>(reader);
+  ret.position = deserialize_position(reader);
   return ret;
 }
 
-BombExploded deserialize_bomb_exploded(TCPReader &tcp_reader) {
+BombExploded deserialize_bomb_exploded(Reader &reader) {
   BombExploded ret;
-  ret.id = deserialize<BombId>(tcp_reader);
-  ret.robots_destroyed = deserialize_vector<PlayerId>(tcp_reader);
-  ret.blocks_destroyed = deserialize_vector<Position>(tcp_reader);
+  ret.id = deserialize<BombId>(reader);
+  ret.robots_destroyed = deserialize_vector<PlayerId>(reader);
+  ret.blocks_destroyed = deserialize_vector<Position>(reader);
   return ret;
 }
 
-PlayerMoved deserialize_player_moved(TCPReader &tcp_reader) {
+PlayerMoved deserialize_player_moved(Reader &reader) {
   PlayerMoved ret;
-  ret.id = deserialize<PlayerId>(tcp_reader);
-  ret.position = deserialize_position(tcp_reader);
+  ret.id = deserialize<PlayerId>(reader);
+  ret.position = deserialize_position(reader);
   return ret;
 }
 
-BlockPlaced deserialize_block_placed(TCPReader &tcp_reader) {
+BlockPlaced deserialize_block_placed(Reader &reader) {
   BlockPlaced ret;
-  ret.position = deserialize_position(tcp_reader);
+  ret.position = deserialize_position(reader);
   return ret;
 }
 
-Event deserialize_event(TCPReader &tcp_reader) {
-  auto type = deserialize<uint8_t>(tcp_reader);
+Event deserialize_event(Reader &reader) {
+  auto type = deserialize<uint8_t>(reader);
   if (type == 0) {
-    return Event{deserialize_bomb_placed(tcp_reader)};
+    return Event{deserialize_bomb_placed(reader)};
   } else if (type == 1) {
-    return Event{deserialize_bomb_exploded(tcp_reader)};
+    return Event{deserialize_bomb_exploded(reader)};
   } else if (type == 2) {
-    return Event{deserialize_player_moved(tcp_reader)};
+    return Event{deserialize_player_moved(reader)};
   } else if (type == 3) {
-    return Event{deserialize_block_placed(tcp_reader)};
+    return Event{deserialize_block_placed(reader)};
   } else {
     throw CouldNotDeserialize();
   }
 }
 
-Hello deserialize_hello(TCPReader &tcp_reader) {
+Hello deserialize_hello(Reader &reader) {
   Hello ret;
-  ret.server_name = deserialize_string(tcp_reader);
-  ret.players_count = deserialize<uint8_t>(tcp_reader);
-  ret.size_x = deserialize<uint16_t>(tcp_reader);
-  ret.size_y = deserialize<uint16_t>(tcp_reader);
-  ret.game_length = deserialize<uint16_t>(tcp_reader);
-  ret.explosion_radius = deserialize<uint16_t>(tcp_reader);
-  ret.bomb_timer = deserialize<uint16_t>(tcp_reader);
+  ret.server_name = deserialize_string(reader);
+  ret.players_count = deserialize<uint8_t>(reader);
+  ret.size_x = deserialize<uint16_t>(reader);
+  ret.size_y = deserialize<uint16_t>(reader);
+  ret.game_length = deserialize<uint16_t>(reader);
+  ret.explosion_radius = deserialize<uint16_t>(reader);
+  ret.bomb_timer = deserialize<uint16_t>(reader);
   return ret;
 }
 
-AcceptedPlayer deserialize_accepted_player(TCPReader &tcp_reader) {
+AcceptedPlayer deserialize_accepted_player(Reader &reader) {
   AcceptedPlayer ret;
-  ret.id = deserialize<PlayerId>(tcp_reader);
-  ret.player = deserialize_player(tcp_reader);
+  ret.id = deserialize<PlayerId>(reader);
+  ret.player = deserialize_player(reader);
   return ret;
 }
 
-GameStarted deserialize_game_started(TCPReader &tcp_reader) {
+GameStarted deserialize_game_started(Reader &reader) {
   GameStarted ret;
-  ret.players = deserialize_map<PlayerId, Player>(tcp_reader);
+  ret.players = deserialize_map<PlayerId, Player>(reader);
   return ret;
 }
 
-Turn deserialize_turn(TCPReader &tcp_reader) {
+Turn deserialize_turn(Reader &reader) {
   Turn ret;
-  ret.turn = deserialize<uint16_t>(tcp_reader);
-  ret.events = deserialize_vector<Event>(tcp_reader);
+  ret.turn = deserialize<uint16_t>(reader);
+  ret.events = deserialize_vector<Event>(reader);
   return ret;
 }
 
-GameEnded deserialize_game_ended(TCPReader &tcp_reader) {
+GameEnded deserialize_game_ended(Reader &reader) {
   GameEnded ret;
-  ret.scores = deserialize_map<PlayerId, Score>(tcp_reader);
+  ret.scores = deserialize_map<PlayerId, Score>(reader);
   return ret;
 }
 
-ServerMessage deserialize_server_message(TCPReader &tcp_reader) {
-  auto type = deserialize<uint8_t>(tcp_reader);
+ServerMessage deserialize_server_message(Reader &reader) {
+  auto type = deserialize<uint8_t>(reader);
   if (type == 0) {
-    return ServerMessage{deserialize_hello(tcp_reader)};
+    return ServerMessage{deserialize_hello(reader)};
   } else if (type == 1) {
-    return ServerMessage{deserialize_accepted_player(tcp_reader)};
+    return ServerMessage{deserialize_accepted_player(reader)};
   } else if (type == 2) {
-    return ServerMessage{deserialize_game_started(tcp_reader)};
+    return ServerMessage{deserialize_game_started(reader)};
   } else if (type == 3) {
-    return ServerMessage{deserialize_turn(tcp_reader)};
+    return ServerMessage{deserialize_turn(reader)};
   } else if (type == 4) {
-    return ServerMessage{deserialize_game_ended(tcp_reader)};
+    return ServerMessage{deserialize_game_ended(reader)};
   } else {
     throw CouldNotDeserialize();
   }
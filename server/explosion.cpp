@@ -0,0 +1,198 @@
+#include <immintrin.h>
+
+#include "explosion.hpp"
+
+namespace {
+
+constexpr size_t CHUNK_SIZE = Board::CHUNK_SIZE;
+constexpr uint64_t ALL = ~uint64_t(0);
+// shorter scans are faster without the vector setup
+constexpr size_t AVX2_MIN_WORDS = 32;
+
+// A row of cells as the kernels see it: the words of its chunks, slot after
+// slot, with the bits of the columns outside [from, to] cleared from the
+// first and the last word.
+struct Row {
+  const uint64_t *words;
+  const uint32_t *slots;
+  size_t row;
+
+  uint64_t word(size_t i) const {
+    return words[size_t(slots[i]) * CHUNK_SIZE + row];
+  }
+};
+
+int first_bit(size_t i, uint64_t word) {
+  return int(i * CHUNK_SIZE + size_t(__builtin_ctzll(word)));
+}
+
+int last_bit(size_t i, uint64_t word) {
+  return int(i * CHUNK_SIZE + CHUNK_SIZE - 1 - size_t(__builtin_clzll(word)));
+}
+
+// the words first..last, the last one masked
+int scan_forward(const Row &row, size_t first, size_t last,
+                 uint64_t last_mask) {
+  for (size_t i = first; i <= last; ++i) {
+    uint64_t word = row.word(i) & (i == last ? last_mask : ALL);
+    if (word)
+      return first_bit(i, word);
+  }
+  return -1;
+}
+
+// the words first..last going down, the last one masked
+int scan_backward(const Row &row, size_t first, size_t last,
+                  uint64_t last_mask) {
+  for (size_t i = first + 1; i-- > last;) {
+    uint64_t word = row.word(i) & (i == last ? last_mask : ALL);
+    if (word)
+      return last_bit(i, word);
+  }
+  return -1;
+}
+
+// Skips the empty chunks of the row eight slots at a time, the words are
+// only read from the chunks that have cells. The words of the chunks are too
+// far apart for gathering them to pay off.
+__attribute__((target("avx2"))) int
+scan_forward_avx2(const Row &row, size_t first, size_t last,
+                  uint64_t last_mask) {
+  const __m256i empty = _mm256_set1_epi32(int(Board::EMPTY_CHUNK));
+  size_t i = first;
+  for (; i + 8 <= last; i += 8) {
+    __m256i slots =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row.slots + i));
+    auto chunks = unsigned(~_mm256_movemask_ps(_mm256_castsi256_ps(
+                               _mm256_cmpeq_epi32(slots, empty))) &
+                           0xff);
+    for (; chunks; chunks &= chunks - 1) {
+      size_t j = i + size_t(__builtin_ctz(chunks));
+      if (uint64_t word = row.word(j))
+        return first_bit(j, word);
+    }
+  }
+  // the tail call to the scalar loop does not clear the upper halves, it
+  // would be slowed down by the AVX-SSE transitions
+  _mm256_zeroupper();
+  return scan_forward(row, i, last, last_mask);
+}
+
+__attribute__((target("avx2"))) int
+scan_backward_avx2(const Row &row, size_t first, size_t last,
+                   uint64_t last_mask) {
+  const __m256i empty = _mm256_set1_epi32(int(Board::EMPTY_CHUNK));
+  // the slots i - 7..i
+  size_t i = first;
+  for (; i >= last + 8; i -= 8) {
+    __m256i slots = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(row.slots + i - 7));
+    auto chunks = unsigned(~_mm256_movemask_ps(_mm256_castsi256_ps(
+                               _mm256_cmpeq_epi32(slots, empty))) &
+                           0xff);
+    for (; chunks; chunks &= ~(1u << (31 - __builtin_clz(chunks)))) {
+      size_t j = i - 7 + size_t(31 - __builtin_clz(chunks));
+      if (uint64_t word = row.word(j))
+        return last_bit(j, word);
+    }
+  }
+  _mm256_zeroupper();
+  return scan_backward(row, i, last, last_mask);
+}
+
+} // namespace
+
+RayKernel best_ray_kernel() {
+  return __builtin_cpu_supports("avx2") ? RayKernel::Avx2 : RayKernel::Scalar;
+}
+
+// The first word is checked here, most rays end in it. The kernels scan the
+// rest.
+int find_in_row(const Board &board, uint16_t y, int from, int to,
+                RayKernel kernel) {
+  const auto &slots = board.row_slots(y);
+  if (slots.empty())
+    return -1;
+  Row row{board.words(), slots.data(), y % CHUNK_SIZE};
+  size_t first = size_t(from) / CHUNK_SIZE;
+  size_t last = size_t(to) / CHUNK_SIZE;
+  if (from <= to) {
+    uint64_t first_mask = ALL << (size_t(from) % CHUNK_SIZE);
+    uint64_t last_mask = ALL >> (CHUNK_SIZE - 1 - size_t(to) % CHUNK_SIZE);
+    uint64_t word =
+        row.word(first) & first_mask & (first == last ? last_mask : ALL);
+    if (word)
+      return first_bit(first, word);
+    if (first == last)
+      return -1;
+    if (kernel == RayKernel::Avx2 && last - first > AVX2_MIN_WORDS)
+      return scan_forward_avx2(row, first + 1, last, last_mask);
+    return scan_forward(row, first + 1, last, last_mask);
+  }
+  uint64_t first_mask = ALL >> (CHUNK_SIZE - 1 - size_t(from) % CHUNK_SIZE);
+  uint64_t last_mask = ALL << (size_t(to) % CHUNK_SIZE);
+  uint64_t word =
+      row.word(first) & first_mask & (first == last ? last_mask : ALL);
+  if (word)
+    return last_bit(first, word);
+  if (first == last)
+    return -1;
+  if (kernel == RayKernel::Avx2 && first - last > AVX2_MIN_WORDS)
+    return scan_backward_avx2(row, first - 1, last, last_mask);
+  return scan_backward(row, first - 1, last, last_mask);
+}
+
+Position ray_cell(const Position &bomb, Direction direction,
+                  uint16_t distance) {
+  switch (direction) {
+  case Up:
+    return {bomb.x, uint16_t(bomb.y + distance)};
+  case Right:
+    return {uint16_t(bomb.x + distance), bomb.y};
+  case Down:
+    return {bomb.x, uint16_t(bomb.y - distance)};
+  case Left:
+    return {uint16_t(bomb.x - distance), bomb.y};
+  }
+  return bomb;
+}
+
+int find_on_ray(const Bitboard &cells, const Position &bomb,
+                Direction direction, int first, int last, RayKernel kernel) {
+  if (first > last)
+    return -1;
+  int x = bomb.x, y = bomb.y, found;
+  switch (direction) {
+  case Right:
+    found = find_in_row(cells.by_rows(), bomb.y, x + first, x + last, kernel);
+    return found < 0 ? -1 : found - x;
+  case Left:
+    found = find_in_row(cells.by_rows(), bomb.y, x - first, x - last, kernel);
+    return found < 0 ? -1 : x - found;
+  case Up:
+    found =
+        find_in_row(cells.by_columns(), bomb.x, y + first, y + last, kernel);
+    return found < 0 ? -1 : found - y;
+  case Down:
+    found =
+        find_in_row(cells.by_columns(), bomb.x, y - first, y - last, kernel);
+    return found < 0 ? -1 : y - found;
+  }
+  return -1;
+}
+
+std::array<Ray, 4> cast_explosion(const Bitboard &blocks, const Position &bomb,
+                                  uint16_t radius, uint16_t size_x,
+                                  uint16_t size_y, RayKernel kernel) {
+  std::array<Ray, 4> ret = {Ray{Right, 0, false}, Ray{Left, 0, false},
+                            Ray{Up, 0, false}, Ray{Down, 0, false}};
+  std::array<int, 4> edges = {size_x - 1 - bomb.x, bomb.x, size_y - 1 - bomb.y,
+                              bomb.y};
+  for (size_t i = 0; i < ret.size(); ++i) {
+    int limit = std::min(int(radius), edges[i]);
+    int block = find_on_ray(blocks, bomb, ret[i].direction, 0, limit, kernel);
+    ret[i].reach = uint16_t(block < 0 ? limit : block);
+    ret[i].blocked = block >= 0;
+  }
+  return ret;
+}
@@ -0,0 +1,61 @@
+#ifndef __EXPLOSION_HPP
+#define __EXPLOSION_HPP
+
+#include <array>
+
+#include "board.hpp"
+#include "messages.hpp"
+
+// Implementations of the scans along the rows of a board.
+enum class RayKernel {
+  // a word of 64 cells at a time
+  Scalar,
+  // skips the chunks without cells eight at a time on long rays
+  Avx2,
+};
+
+// the fastest kernel the CPU supports
+RayKernel best_ray_kernel();
+
+// the column of the nearest cell of the set in row y, between the columns
+// from and to (inclusive, from > to searches leftwards), -1 if there is none
+int find_in_row(const Board &board, uint16_t y, int from, int to,
+                RayKernel kernel);
+
+// A ray of an explosion: the cells at distances 0..reach from the bomb are
+// hit, and the last one is a block if the ray is blocked.
+struct Ray {
+  Direction direction;
+  uint16_t reach;
+  bool blocked;
+};
+
+// the cell of a ray at the given distance from the bomb
+Position ray_cell(const Position &bomb, Direction direction,
+                  uint16_t distance);
+
+// Casts the four rays of an explosion, right, left, up and down, in the
+// order in which the server reports what they hit. A ray ends at the first
+// block, at the edge of the board or after radius cells.
+std::array<Ray, 4> cast_explosion(const Bitboard &blocks, const Position &bomb,
+                                  uint16_t radius, uint16_t size_x,
+                                  uint16_t size_y, RayKernel kernel);
+
+// the distance of the nearest cell of the set on a ray from the bomb, between
+// the distances first and last (inclusive), -1 if there is none
+int find_on_ray(const Bitboard &cells, const Position &bomb,
+                Direction direction, int first, int last, RayKernel kernel);
+
+// calls f(distance) for every cell of the set hit by the ray, nearest first
+template <typename F>
+void for_each_on_ray(const Bitboard &cells, const Position &bomb,
+                     const Ray &ray, RayKernel kernel, F f) {
+  for (int distance = find_on_ray(cells, bomb, ray.direction, 0, ray.reach,
+                                  kernel);
+       distance >= 0;
+       distance = find_on_ray(cells, bomb, ray.direction, distance + 1,
+                              ray.reach, kernel))
+    f(uint16_t(distance));
+}
+
+#endif // __EXPLOSION_HPP
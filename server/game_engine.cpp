@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <set>
+
+#include "game_engine.hpp"
+#include "trace.hpp"
+
+GameState::GameState(const ServerOptions &server_options, uint32_t seed)
+    : random(seed), blocks(server_options.size_x, server_options.size_y),
+      ticking_bombs(server_options.bomb_timer) {}
+
+void GameState::clear() {
+  robots.clear();
+  blocks.clear();
+  scores.clear();
+  ticking_bombs.clear();
+  next_bomb_id = 0;
+  turn = 0;
+  last_explosions.clear();
+}
+
+namespace {
+
+// fewer bombs are not worth waking up the helpers
+constexpr size_t PARALLEL_MIN_BOMBS = 64;
+// more strips than threads even out the bombs gathered in a few strips
+constexpr size_t STRIPS_PER_THREAD = 4;
+
+} // namespace
+
+GameEngine::GameEngine(const ServerOptions &server_options_,
+                       TurnPool *turn_pool_)
+    : server_options(server_options_), ray_kernel(best_ray_kernel()),
+      turn_pool(turn_pool_) {}
+
+Position GameEngine::generate_position(GameState &state) const {
+  Position position;
+  position.x = uint16_t(state.random() % server_options.size_x);
+  position.y = uint16_t(state.random() % server_options.size_y);
+  return position;
+}
+
+bool GameEngine::is_legal(int x, int y) const {
+  return x >= 0 && x < server_options.size_x && y >= 0 &&
+         y < server_options.size_y;
+}
+
+Turn GameEngine::start(GameState &state) const {
+  state.turn = 0;
+  Turn turn_0;
+  turn_0.turn = 0;
+  for (PlayerId player_id = 0; player_id < server_options.players_count;
+       ++player_id) {
+    auto position = generate_position(state);
+    state.robots.place(player_id, position);
+    state.scores[player_id] = 0;
+    PlayerMoved player_moved;
+    player_moved.id = player_id;
+    player_moved.position = position;
+    turn_0.events.emplace_back(player_moved);
+  }
+  for (uint16_t i = 0; i < server_options.initial_blocks; ++i) {
+    auto position = generate_position(state);
+    if (state.blocks.contains(position))
+      continue;
+    state.blocks.emplace(position);
+    turn_0.events.emplace_back(BlockPlaced{position});
+  }
+  return turn_0;
+}
+
+Turn GameEngine::step(GameState &state, const Inputs &inputs) const {
+  Turn turn;
+  turn.turn = ++state.turn;
+
+  std::set<PlayerId> exploded_players;
+  std::vector<Position> exploded_blocks;
+  std::vector<Position> blocks_to_be_placed;
+  state.last_explosions.clear();
+
+  // updating ticking bombs
+  std::vector<std::pair<BombId, Position>> exploding_bombs;
+  {
+    TRACE_SPAN("bombs");
+    exploding_bombs = state.ticking_bombs.advance();
+  }
+
+  // explosions
+  {
+    TRACE_SPAN("explosions");
+    auto explosions = explode_all(state, exploding_bombs);
+    for (size_t i = 0; i < explosions.size(); ++i) {
+      for (const auto &player_id : explosions[i].robots_destroyed)
+        exploded_players.emplace(player_id);
+      exploded_blocks.insert(exploded_blocks.end(),
+                             explosions[i].blocks_destroyed.begin(),
+                             explosions[i].blocks_destroyed.end());
+      turn.events.emplace_back(explosions[i]);
+      state.last_explosions.emplace_back(std::move(explosions[i]),
+                                         exploding_bombs[i].second);
+    }
+
+    // updating scores
+    for (const auto &player_id : exploded_players)
+      ++state.scores[player_id];
+  }
+
+  // player actions
+  {
+    TRACE_SPAN("inputs");
+    for (PlayerId player_id = 0; player_id < server_options.players_count;
+         ++player_id) {
+      if (exploded_players.contains(player_id)) {
+        PlayerMoved player_moved;
+        player_moved.id = player_id;
+        player_moved.position = generate_position(state);
+        turn.events.emplace_back(player_moved);
+        state.robots.place(player_id, player_moved.position);
+        continue;
+      }
+      if (player_id >= inputs.size() || !inputs[player_id])
+        continue;
+      const auto &client_message = *inputs[player_id];
+      if (std::holds_alternative<PlaceBomb>(client_message.m)) {
+        auto bomb_id = state.next_bomb_id++;
+        auto position = state.robots.position(player_id);
+        state.ticking_bombs.schedule(bomb_id, position);
+        turn.events.emplace_back(BombPlaced{bomb_id, position});
+      } else if (std::holds_alternative<PlaceBlock>(client_message.m)) {
+        auto position = state.robots.position(player_id);
+        if (!state.blocks.contains(position)) {
+          blocks_to_be_placed.emplace_back(position);
+          turn.events.emplace_back(BlockPlaced{position});
+        }
+      } else if (std::holds_alternative<Move>(client_message.m)) {
+        auto [x, y] = state.robots.position(player_id).move(
+            std::get<Move>(client_message.m).direction);
+        if (is_legal(x, y)) {
+          Position new_position = {uint16_t(x), uint16_t(y)};
+          if (!state.blocks.contains(new_position)) {
+            state.robots.place(player_id, new_position);
+            turn.events.emplace_back(PlayerMoved{player_id, new_position});
+          }
+        }
+      }
+    }
+  }
+
+  // block changes
+  {
+    TRACE_SPAN("blocks");
+    for (const auto &block : exploded_blocks)
+      state.blocks.erase(block);
+    for (const auto &block : blocks_to_be_placed)
+      state.blocks.emplace(block);
+  }
+
+  return turn;
+}
+
+BombExploded GameEngine::explode(const GameState &state, BombId bomb_id,
+                                 const Position &bomb_position) const {
+  BombExploded ret;
+  ret.id = bomb_id;
+  auto rays = cast_explosion(state.blocks, bomb_position,
+                             server_options.explosion_radius,
+                             server_options.size_x, server_options.size_y,
+                             ray_kernel);
+  for (const auto &ray : rays) {
+    // only the cells with robots are visited
+    for_each_on_ray(state.robots.occupied_cells(), bomb_position, ray,
+                    ray_kernel, [&](uint16_t distance) {
+                      const auto &robots = state.robots.at(
+                          ray_cell(bomb_position, ray.direction, distance));
+                      ret.robots_destroyed.insert(ret.robots_destroyed.end(),
+                                                  robots.begin(),
+                                                  robots.end());
+                    });
+    if (ray.blocked) {
+      ret.blocks_destroyed.emplace_back(
+          ray_cell(bomb_position, ray.direction, ray.reach));
+    }
+  }
+  return ret;
+}
+
+// The board is split into horizontal strips, and the bombs of a strip are
+// exploded by one task, which keeps the part of the boards that it reads
+// small. The explosions are returned in the order of the bombs, as if they
+// were computed one after another.
+std::vector<BombExploded> GameEngine::explode_all(
+    const GameState &state,
+    const std::vector<std::pair<BombId, Position>> &bombs) const {
+  std::vector<BombExploded> ret(bombs.size());
+  if (!turn_pool || turn_pool->concurrency() == 1 ||
+      bombs.size() < PARALLEL_MIN_BOMBS) {
+    for (size_t i = 0; i < bombs.size(); ++i)
+      ret[i] = explode(state, bombs[i].first, bombs[i].second);
+    return ret;
+  }
+
+  size_t strips = turn_pool->concurrency() * STRIPS_PER_THREAD;
+  std::vector<std::vector<size_t>> strip_bombs(strips);
+  for (size_t i = 0; i < bombs.size(); ++i) {
+    strip_bombs[size_t(bombs[i].second.y) * strips / server_options.size_y]
+        .emplace_back(i);
+  }
+  turn_pool->run(strips, [&](size_t strip) {
+    for (auto i : strip_bombs[strip])
+      ret[i] = explode(state, bombs[i].first, bombs[i].second);
+  });
+  return ret;
+}
+
+// A client gives a destroyed robot at most one point per turn, so a player
+// with score s is destroyed by a made up bomb in each of the first s turns.
+// A ticking bomb is placed as many turns before the last one as it has been
+// ticking. The last turn repeats the explosions of the current one without
+// the destroyed robots, then moves all robots and places all blocks.
+std::vector<Turn> GameEngine::snapshot(const GameState &state) const {
+  TRACE_SPAN("snapshot");
+  constexpr int64_t TIMER_PERIOD = int64_t(1) << 16;
+  const int64_t delay =
+      server_options.bomb_timer == 0 ? TIMER_PERIOD : server_options.bomb_timer;
+
+  std::vector<std::pair<int64_t, BombPlaced>> placed_bombs;
+  int64_t length = state.last_explosions.empty() ? 1 : 2;
+  state.ticking_bombs.for_each(
+      [&](BombId bomb_id, const Position &position, uint16_t timer) {
+        int64_t age = (delay - timer) % TIMER_PERIOD;
+        placed_bombs.emplace_back(age, BombPlaced{bomb_id, position});
+        length = std::max(length, age + 1);
+      });
+  for (const auto &[player_id, score] : state.scores)
+    length = std::max(length, int64_t(score) + 1);
+
+  std::vector<Turn> ret(size_t(length), Turn{state.turn, {}});
+  auto &last_turn = ret.back();
+
+  // scores, the made up bomb is never placed
+  std::vector<BombExploded> scoring(size_t(length - 1));
+  for (const auto &[player_id, score] : state.scores) {
+    for (Score i = 0; i < score; ++i)
+      scoring[i].robots_destroyed.emplace_back(player_id);
+  }
+  for (size_t i = 0; i < scoring.size(); ++i) {
+    if (scoring[i].robots_destroyed.empty())
+      continue;
+    scoring[i].id = state.next_bomb_id;
+    ret[i].events.emplace_back(scoring[i]);
+  }
+
+  // bombs exploding in the last turn have to be ticking until it
+  for (const auto &[bomb_exploded, position] : state.last_explosions) {
+    auto placed = std::max(int64_t(0), length - 1 - delay);
+    ret[size_t(placed)].events.emplace_back(
+        BombPlaced{bomb_exploded.id, position});
+  }
+  for (const auto &[age, bomb_placed] : placed_bombs) {
+    if (age > 0)
+      ret[size_t(length - 1 - age)].events.emplace_back(bomb_placed);
+  }
+
+  for (auto [bomb_exploded, _position] : state.last_explosions) {
+    bomb_exploded.robots_destroyed.clear();
+    last_turn.events.emplace_back(bomb_exploded);
+  }
+  for (const auto &[player_id, position] : state.robots.all())
+    last_turn.events.emplace_back(PlayerMoved{player_id, position});
+  state.blocks.for_each([&](const Position &position) {
+    last_turn.events.emplace_back(BlockPlaced{position});
+  });
+  for (const auto &[age, bomb_placed] : placed_bombs) {
+    if (age == 0)
+      last_turn.events.emplace_back(bomb_placed);
+  }
+  return ret;
+}
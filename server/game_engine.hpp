@@ -0,0 +1,80 @@
+#ifndef __GAME_ENGINE_HPP
+#define __GAME_ENGINE_HPP
+
+#include <map>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "board.hpp"
+#include "explosion.hpp"
+#include "messages.hpp"
+#include "robot_index.hpp"
+#include "server_options.hpp"
+#include "timing_wheel.hpp"
+#include "turn_pool.hpp"
+
+// The state of a game between two turns. The random generator outlives the
+// games, so that a room plays a different game every time.
+struct GameState {
+  GameState(const ServerOptions &server_options, uint32_t seed);
+
+  // ends the game, keeping the random generator
+  void clear();
+
+  std::minstd_rand random;
+  RobotIndex robots;
+  Bitboard blocks;
+  std::map<PlayerId, Score> scores;
+  TimingWheel<BombId, Position> ticking_bombs;
+  BombId next_bomb_id = 0;
+  uint16_t turn = 0;
+  // bombs that exploded in the last turn, with their positions
+  std::vector<std::pair<BombExploded, Position>> last_explosions;
+};
+
+// the latest action of every player in a turn, indexed by the player ids
+using Inputs = std::vector<std::optional<ClientMessage>>;
+
+// The rules of the game, without any sockets or timers. Given the same seed
+// and inputs, a game always plays out the same way, also when the explosions
+// are split between the threads of a turn pool.
+class GameEngine {
+public:
+  // plays the turns on the calling thread alone if turn_pool_ is null
+  explicit GameEngine(const ServerOptions &server_options_,
+                      TurnPool *turn_pool_ = nullptr);
+
+  // places the robots and the initial blocks
+  Turn start(GameState &state) const;
+
+  // plays the next turn
+  Turn step(GameState &state, const Inputs &inputs) const;
+
+  bool is_over(const GameState &state) const {
+    return state.turn == server_options.game_length;
+  }
+
+  // Turns that rebuild the state for a client that knows only the players,
+  // so that catching up costs as much as the state and not as the history
+  // of the game. All of them carry the number of the current turn.
+  std::vector<Turn> snapshot(const GameState &state) const;
+
+private:
+  const ServerOptions &server_options;
+  RayKernel ray_kernel;
+  TurnPool *turn_pool;
+
+  Position generate_position(GameState &state) const;
+  bool is_legal(int x, int y) const;
+
+  // the robots and blocks hit by a bomb, only reads the state
+  BombExploded explode(const GameState &state, BombId bomb_id,
+                       const Position &bomb_position) const;
+  // explode() for every bomb, in parallel strips of the board
+  std::vector<BombExploded>
+  explode_all(const GameState &state,
+              const std::vector<std::pair<BombId, Position>> &bombs) const;
+};
+
+#endif // __GAME_ENGINE_HPP
@@ -0,0 +1,117 @@
+#include <boost/numeric/conversion/cast.hpp>
+#include <boost/program_options.hpp>
+#include <iostream>
+
+#include "loadgen_options.hpp"
+
+LoadgenOptions get_loadgen_options(int argc, char **argv) {
+  namespace po = boost::program_options;
+  try {
+    po::options_description desc("Allowed options");
+    desc.add_options()("connections,c", po::value<uint32_t>(),
+                       "<u32, optional parameter>")("help,h", "")(
+        "player-name,n", po::value<std::string>(),
+        "<String, optional parameter>")(
+        "ramp-up,r", po::value<uint16_t>(),
+        "<u16, seconds, optional parameter>")(
+        "server-address,s", po::value<std::string>(),
+        "<(host name):(port) or (IPv4):(port) or (IPv6):(port)>")(
+        "duration,t", po::value<uint16_t>(),
+        "<u16, seconds, optional parameter>")(
+        "script", po::value<std::string>(),
+        "<file with one action per line: up, right, down, left, bomb, block "
+        "or wait, optional parameter>")(
+        "seed", po::value<uint32_t>(), "<u32, optional parameter>")(
+        "spectators", po::value<uint32_t>(), "<u32, optional parameter>");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      exit(0);
+    }
+
+    LoadgenOptions ret;
+    std::vector<std::string> missing_options;
+
+    auto check_option =
+        [&]<typename T>(const std::string &s, T &elem, bool required = true) {
+      if (vm.count(s)) {
+        elem = vm[s].as<T>();
+      } else if (required) {
+        missing_options.emplace_back(s);
+      }
+    };
+
+    ret.connections = 1000;
+    check_option("connections", ret.connections, false);
+    ret.spectators = 0;
+    check_option("spectators", ret.spectators, false);
+    ret.ramp_up = 0;
+    check_option("ramp-up", ret.ramp_up, false);
+    ret.duration = 10;
+    check_option("duration", ret.duration, false);
+    ret.player_name = "loadgen";
+    check_option("player-name", ret.player_name, false);
+    check_option("script", ret.script, false);
+    ret.seed = 0;
+    check_option("seed", ret.seed, false);
+
+    if (ret.spectators > ret.connections) {
+      throw std::runtime_error("the argument ('" +
+                               std::to_string(ret.spectators) +
+                               "') for option '--spectators' is invalid");
+    }
+    if (ret.player_name.length() > 255) {
+      throw std::runtime_error("the argument ('" + ret.player_name +
+                               "') for option '--player-name' is invalid");
+    }
+
+    auto throw_invalid_address = [](const std::string &s) {
+      throw std::runtime_error(s + " is not a valid address");
+    };
+    auto split_address =
+        [&](const std::string &s) -> std::pair<std::string, uint16_t> {
+      auto last_colon = s.rfind(":");
+      if (last_colon == std::string::npos) {
+        throw_invalid_address(s);
+      }
+      uint16_t port;
+      try {
+        port = boost::numeric_cast<uint16_t>(boost::lexical_cast<int>(
+            s.substr(last_colon + 1, s.length() - last_colon - 1)));
+      } catch (...) {
+        throw_invalid_address(s);
+      }
+      if (last_colon != 0 && s.at(0) == '[' && s.at(last_colon - 1) == ']')
+        return {s.substr(1, last_colon - 2), port};
+      else
+        return {s.substr(0, last_colon), port};
+    };
+    if (vm.count("server-address")) {
+      std::tie(ret.server_address, ret.server_port) =
+          split_address(vm["server-address"].as<std::string>());
+    } else {
+      missing_options.emplace_back("server-address");
+    }
+
+    if (missing_options.empty()) {
+      return ret;
+    } else {
+      std::cerr << "Missing options:\n";
+      for (auto option : missing_options) {
+        std::cerr << "  --" << option << '\n';
+      }
+      std::cerr << std::endl;
+      exit(1);
+    }
+  } catch (std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    exit(1);
+  } catch (...) {
+    std::cerr << "Exception of unknown type!" << std::endl;
+    exit(1);
+  }
+}
@@ -0,0 +1,25 @@
+#ifndef __LOADGEN_OPTIONS_HPP
+#define __LOADGEN_OPTIONS_HPP
+
+#include <cstdint>
+#include <string>
+
+struct LoadgenOptions {
+  std::string server_address;
+  uint16_t server_port;
+  uint32_t connections;
+  // the last connections only watch the game
+  uint32_t spectators;
+  // seconds over which the connections are opened
+  uint16_t ramp_up;
+  // seconds after which the results are printed
+  uint16_t duration;
+  std::string player_name;
+  // the actions to cycle through instead of random ones, if not empty
+  std::string script;
+  uint32_t seed;
+};
+
+LoadgenOptions get_loadgen_options(int argc, char **argv);
+
+#endif // __LOADGEN_OPTIONS_HPP
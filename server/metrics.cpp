@@ -0,0 +1,118 @@
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "metrics.hpp"
+
+namespace metrics {
+
+namespace {
+
+struct Description {
+  const char *name;
+  const char *help;
+};
+
+constexpr std::array<Description, size_t(Counter::COUNT)> COUNTERS = {{
+    {"robots_bytes_sent_total", "Bytes written to the clients."},
+    {"robots_messages_sent_total", "Server messages written to the clients."},
+    {"robots_writes_total",
+     "Write system calls to the clients, each one sends a batch of messages."},
+    {"robots_accepts_total", "Connections accepted."},
+    {"robots_messages_decoded_total", "Client messages decoded."},
+    {"robots_deserialization_failures_total",
+     "Connections closed because of an invalid client message."},
+    {"robots_turns_total", "Turns played in all the rooms."},
+    {"robots_turn_overruns_total",
+     "Turns that ended after the deadline of the next one."},
+    {"robots_lock_wait_seconds_total",
+     "Time spent waiting for the client lists of the rooms."},
+}};
+
+constexpr std::array<Description, size_t(Histogram::COUNT)> HISTOGRAMS = {{
+    {"robots_turn_duration_seconds", "Time spent computing a turn."},
+    {"robots_broadcast_duration_seconds",
+     "Time spent encoding a turn and queueing it for all the clients."},
+}};
+
+// the shards outlive their threads, so that nothing counted is lost
+std::mutex shards_mutex;
+std::vector<std::unique_ptr<Shard>> shards;
+
+Shard &new_shard() {
+  std::lock_guard<std::mutex> lock(shards_mutex);
+  return *shards.emplace_back(std::make_unique<Shard>());
+}
+
+double seconds(uint64_t ns) { return double(ns) / 1e9; }
+
+} // namespace
+
+Shard &local_shard() {
+  // a pointer is initialized without a guard, unlike a thread_local Shard
+  thread_local Shard *shard = nullptr;
+  if (!shard)
+    shard = &new_shard();
+  return *shard;
+}
+
+uint64_t total(Counter counter) {
+  uint64_t ret = 0;
+  std::lock_guard<std::mutex> lock(shards_mutex);
+  for (const auto &shard : shards)
+    ret += shard->counters[size_t(counter)].load(std::memory_order_relaxed);
+  return ret;
+}
+
+void write(std::ostream &out) {
+  std::array<uint64_t, size_t(Counter::COUNT)> counters{};
+  std::array<std::array<uint64_t, BUCKETS.size() + 1>,
+             size_t(Histogram::COUNT)>
+      buckets{};
+  std::array<uint64_t, size_t(Histogram::COUNT)> sums{};
+  {
+    std::lock_guard<std::mutex> lock(shards_mutex);
+    for (const auto &shard : shards) {
+      for (size_t i = 0; i < counters.size(); ++i)
+        counters[i] += shard->counters[i].load(std::memory_order_relaxed);
+      for (size_t i = 0; i < sums.size(); ++i) {
+        const auto &histogram = shard->histograms[i];
+        for (size_t j = 0; j < buckets[i].size(); ++j)
+          buckets[i][j] += histogram.buckets[j].load(std::memory_order_relaxed);
+        sums[i] += histogram.sum.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  auto precision = out.precision(10);
+  for (size_t i = 0; i < counters.size(); ++i) {
+    const auto &[name, help] = COUNTERS[i];
+    out << "# HELP " << name << " " << help << "\n# TYPE " << name
+        << " counter\n"
+        << name << " ";
+    if (Counter(i) == Counter::LockWaitNanoseconds)
+      out << seconds(counters[i]) << "\n";
+    else
+      out << counters[i] << "\n";
+  }
+  for (size_t i = 0; i < sums.size(); ++i) {
+    const auto &[name, help] = HISTOGRAMS[i];
+    out << "# HELP " << name << " " << help << "\n# TYPE " << name
+        << " histogram\n";
+    // the buckets are cumulative
+    uint64_t count = 0;
+    for (size_t j = 0; j < BUCKETS.size(); ++j) {
+      count += buckets[i][j];
+      out << name << "_bucket{le=\"" << seconds(BUCKETS[j]) << "\"} " << count
+          << "\n";
+    }
+    count += buckets[i].back();
+    out << name << "_bucket{le=\"+Inf\"} " << count << "\n"
+        << name << "_sum " << seconds(sums[i]) << "\n"
+        << name << "_count " << count << "\n";
+  }
+  out.precision(precision);
+}
+
+} // namespace metrics
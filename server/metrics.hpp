@@ -0,0 +1,110 @@
+#ifndef __METRICS_HPP
+#define __METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Counters and histograms of the process. Every thread updates a shard of
+// its own with plain (not read-modify-write) relaxed stores, so that the
+// collection costs next to nothing on the hot paths; the shards are summed
+// up only when the metrics are scraped.
+namespace metrics {
+
+enum class Counter {
+  BytesSent,
+  MessagesSent,
+  // system calls writing to the clients
+  Writes,
+  Accepts,
+  MessagesDecoded,
+  DeserializationFailures,
+  TurnsPlayed,
+  TurnOverruns,
+  LockWaitNanoseconds,
+  COUNT,
+};
+
+enum class Histogram {
+  TurnDuration,
+  BroadcastDuration,
+  COUNT,
+};
+
+using clock = std::chrono::steady_clock;
+
+// upper bounds of the histogram buckets, in nanoseconds, the last bucket has
+// no bound
+constexpr std::array<uint64_t, 12> BUCKETS = {
+    1'000,      4'000,       16'000,        64'000,
+    256'000,    1'024'000,   4'096'000,     16'384'000,
+    65'536'000, 262'144'000, 1'048'576'000, 4'194'304'000};
+
+struct Shard {
+  std::array<std::atomic<uint64_t>, size_t(Counter::COUNT)> counters{};
+  struct HistogramShard {
+    std::array<std::atomic<uint64_t>, BUCKETS.size() + 1> buckets{};
+    std::atomic<uint64_t> sum{0};
+  };
+  std::array<HistogramShard, size_t(Histogram::COUNT)> histograms{};
+};
+
+// the shard of the calling thread
+Shard &local_shard();
+
+inline void increment(std::atomic<uint64_t> &x, uint64_t value) {
+  // only the owning thread writes to a shard
+  x.store(x.load(std::memory_order_relaxed) + value,
+          std::memory_order_relaxed);
+}
+
+inline void add(Counter counter, uint64_t value = 1) {
+  increment(local_shard().counters[size_t(counter)], value);
+}
+
+inline void observe(Histogram histogram, clock::duration duration) {
+  auto ns = uint64_t(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+  size_t bucket = 0;
+  while (bucket < BUCKETS.size() && ns > BUCKETS[bucket])
+    ++bucket;
+  auto &shard = local_shard().histograms[size_t(histogram)];
+  increment(shard.buckets[bucket], 1);
+  increment(shard.sum, ns);
+}
+
+// a counter summed over all the threads
+uint64_t total(Counter counter);
+
+// writes the counters and histograms summed over all the threads in the
+// Prometheus text format
+void write(std::ostream &out);
+
+// A lock_guard that counts the time spent waiting for a contended mutex. An
+// uncontended lock costs a try_lock only.
+template <typename Mutex> class TimedLock {
+public:
+  explicit TimedLock(Mutex &mutex_) : mutex(mutex_) {
+    if (!mutex.try_lock()) {
+      auto start = clock::now();
+      mutex.lock();
+      add(Counter::LockWaitNanoseconds,
+          uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       clock::now() - start)
+                       .count()));
+    }
+  }
+  ~TimedLock() { mutex.unlock(); }
+
+  TimedLock(const TimedLock &) = delete;
+  TimedLock &operator=(const TimedLock &) = delete;
+
+private:
+  Mutex &mutex;
+};
+
+} // namespace metrics
+
+#endif // __METRICS_HPP
@@ -0,0 +1,76 @@
+#include <memory>
+#include <sstream>
+
+#include "metrics.hpp"
+#include "metrics_server.hpp"
+
+using boost::asio::ip::tcp;
+
+namespace {
+
+// requests larger than that are not answered
+constexpr size_t MAX_REQUEST_SIZE = 8192;
+
+class Scrape : public std::enable_shared_from_this<Scrape> {
+public:
+  Scrape(tcp::socket socket_, const MetricsServer::gauges_t &gauges_)
+      : socket(std::move(socket_)), request(MAX_REQUEST_SIZE),
+        gauges(gauges_) {}
+
+  void start() {
+    boost::asio::async_read_until(
+        socket, request, "\r\n\r\n",
+        [self = shared_from_this()](const boost::system::error_code &error,
+                                    size_t) {
+          if (!error)
+            self->respond();
+        });
+  }
+
+private:
+  tcp::socket socket;
+  boost::asio::streambuf request;
+  const MetricsServer::gauges_t &gauges;
+  std::string response;
+
+  void respond() {
+    std::ostringstream body;
+    metrics::write(body);
+    gauges(body);
+    auto text = body.str();
+    response = "HTTP/1.0 200 OK\r\n"
+               "Content-Type: text/plain; version=0.0.4\r\n"
+               "Content-Length: " +
+               std::to_string(text.size()) +
+               "\r\n"
+               "Connection: close\r\n\r\n" +
+               text;
+    boost::asio::async_write(
+        socket, boost::asio::buffer(response),
+        [self = shared_from_this()](const boost::system::error_code &,
+                                    size_t) {
+          boost::system::error_code ignored;
+          self->socket.shutdown(tcp::socket::shutdown_both, ignored);
+        });
+  }
+};
+
+} // namespace
+
+MetricsServer::MetricsServer(boost::asio::io_context &io_context,
+                             uint16_t port, gauges_t gauges_)
+    : acceptor(io_context,
+               tcp::endpoint(boost::asio::ip::address_v4::loopback(), port)),
+      gauges(std::move(gauges_)) {
+  accept();
+}
+
+void MetricsServer::accept() {
+  acceptor.async_accept(
+      boost::asio::make_strand(acceptor.get_executor()),
+      [this](const boost::system::error_code &error, tcp::socket socket) {
+        if (!error)
+          std::make_shared<Scrape>(std::move(socket), gauges)->start();
+        accept();
+      });
+}
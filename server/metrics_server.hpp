@@ -0,0 +1,29 @@
+#ifndef __METRICS_SERVER_HPP
+#define __METRICS_SERVER_HPP
+
+// boost/asio/awaitable.hpp uses std::exchange without including <utility>
+#include <utility>
+
+#include <boost/asio.hpp>
+#include <functional>
+#include <ostream>
+
+// Serves the metrics over HTTP on the loopback interface: every request,
+// whatever its path, gets the counters and histograms of the process
+// followed by the gauges.
+class MetricsServer {
+public:
+  using gauges_t = std::function<void(std::ostream &)>;
+
+  // throws boost::system::system_error if the port cannot be bound
+  MetricsServer(boost::asio::io_context &io_context, uint16_t port,
+                gauges_t gauges_);
+
+private:
+  boost::asio::ip::tcp::acceptor acceptor;
+  gauges_t gauges;
+
+  void accept();
+};
+
+#endif // __METRICS_SERVER_HPP
@@ -0,0 +1,41 @@
+#ifndef __REPLAY_FORMAT_HPP
+#define __REPLAY_FORMAT_HPP
+
+#include <array>
+#include <cstdint>
+
+// A replay file records a single game as the server sent it: a header
+// followed by records, each one a server message in the wire encoding
+// prefixed with its length. The messages are Hello, GameStarted, every Turn
+// and GameEnded, the last records may be missing if the server stopped
+// during the game.
+//
+// Every keyframe interval turns the Turn is followed by a keyframe, the whole
+// state after it (see ReplayState), so that a reader can seek to a turn by
+// applying at most that many turns. A closed file ends with an index of the
+// keyframes and the offset of the index record.
+//
+//   header:   REPLAY_MAGIC, REPLAY_VERSION (u32), keyframe interval (u16)
+//   record:   length (u32), message (length bytes)
+//   keyframe: length (u32), KEYFRAME_TAG, state
+//   index:    length (u32), INDEX_TAG, count (u32), count times turn (u16)
+//             and offset of the keyframe record (u64)
+//   footer:   offset of the index record (u64)
+//
+// All the integers are big-endian, like in the wire encoding. The tags of the
+// records that are not server messages do not collide with the message tags.
+
+constexpr std::array<uint8_t, 8> REPLAY_MAGIC = {'R', 'O', 'B', 'O',
+                                                 'T', 'S', 'R', 'P'};
+constexpr uint32_t REPLAY_VERSION = 2;
+constexpr size_t REPLAY_HEADER_SIZE = REPLAY_MAGIC.size() + 4 + 2;
+constexpr size_t REPLAY_LENGTH_SIZE = 4;
+constexpr size_t REPLAY_FOOTER_SIZE = 8;
+constexpr size_t REPLAY_INDEX_ENTRY_SIZE = 2 + 8;
+
+constexpr uint8_t TURN_TAG = 3;
+constexpr uint8_t GAME_ENDED_TAG = 4;
+constexpr uint8_t KEYFRAME_TAG = 0x80;
+constexpr uint8_t INDEX_TAG = 0x81;
+
+#endif // __REPLAY_FORMAT_HPP
@@ -0,0 +1,58 @@
+#include <boost/program_options.hpp>
+#include <iostream>
+
+#include "replay_options.hpp"
+
+ReplayOptions get_replay_options(int argc, char **argv) {
+  namespace po = boost::program_options;
+  try {
+    po::options_description desc("Allowed options");
+    desc.add_options()("turn-duration,d", po::value<uint64_t>(),
+                       "<u64, milliseconds, optional parameter>")(
+        "file,f", po::value<std::string>(), "<path>")("help,h", "")(
+        "port,p", po::value<uint16_t>(), "<u16>");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      exit(0);
+    }
+
+    ReplayOptions ret;
+    std::vector<std::string> missing_options;
+
+    auto check_option =
+        [&]<typename T>(const std::string &s, T &elem, bool required = true) {
+      if (vm.count(s)) {
+        elem = vm[s].as<T>();
+      } else if (required) {
+        missing_options.emplace_back(s);
+      }
+    };
+
+    check_option("file", ret.file);
+    check_option("port", ret.port);
+    ret.turn_duration = 100;
+    check_option("turn-duration", ret.turn_duration, false);
+
+    if (missing_options.empty()) {
+      return ret;
+    } else {
+      std::cerr << "Missing options:\n";
+      for (auto option : missing_options) {
+        std::cerr << "  --" << option << '\n';
+      }
+      std::cerr << std::endl;
+      exit(1);
+    }
+  } catch (std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    exit(1);
+  } catch (...) {
+    std::cerr << "Exception of unknown type!" << std::endl;
+    exit(1);
+  }
+}
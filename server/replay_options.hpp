@@ -0,0 +1,15 @@
+#ifndef __REPLAY_OPTIONS_HPP
+#define __REPLAY_OPTIONS_HPP
+
+#include <cstdint>
+#include <string>
+
+struct ReplayOptions {
+  std::string file;
+  uint16_t port;
+  uint64_t turn_duration;
+};
+
+ReplayOptions get_replay_options(int argc, char **argv);
+
+#endif // __REPLAY_OPTIONS_HPP
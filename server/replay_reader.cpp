@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "deserialize.hpp"
+#include "reader.hpp"
+#include "replay_format.hpp"
+#include "replay_reader.hpp"
+
+namespace {
+
+template <std::integral T> T read_integral(const uint8_t *bytes) {
+  T ret = 0;
+  for (size_t i = 0; i < sizeof(T); ++i)
+    ret = T(ret << 8 | bytes[i]);
+  return ret;
+}
+
+uint32_t read_u32(const uint8_t *bytes) {
+  return read_integral<uint32_t>(bytes);
+}
+
+bool is_turn(ReplayReader::record_t record) {
+  return !record.empty() && record[0] == TURN_TAG;
+}
+
+// the number of a turn or of a keyframe
+uint16_t turn_number(ReplayReader::record_t record) {
+  return record.size() < 3 ? 0 : read_integral<uint16_t>(record.data() + 1);
+}
+
+} // namespace
+
+ReplayReader::ReplayReader(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw InvalidReplay();
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) < 0 ||
+      size_t(file_stat.st_size) < REPLAY_HEADER_SIZE) {
+    ::close(fd);
+    throw InvalidReplay();
+  }
+  size = size_t(file_stat.st_size);
+  void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    throw InvalidReplay();
+  data = static_cast<const uint8_t *>(mapping);
+  madvise(mapping, size, MADV_SEQUENTIAL);
+
+  if (!std::equal(REPLAY_MAGIC.begin(), REPLAY_MAGIC.end(), data) ||
+      read_u32(data + REPLAY_MAGIC.size()) != REPLAY_VERSION) {
+    munmap(mapping, size);
+    throw InvalidReplay();
+  }
+  interval = read_integral<uint16_t>(data + REPLAY_MAGIC.size() + 4);
+  if (!read_index()) {
+    records_end = size;
+    scan_keyframes();
+  }
+}
+
+bool ReplayReader::read_index() {
+  if (size < REPLAY_HEADER_SIZE + REPLAY_LENGTH_SIZE + REPLAY_FOOTER_SIZE)
+    return false;
+  auto index = read_integral<uint64_t>(data + size - REPLAY_FOOTER_SIZE);
+  size_t index_end = size - REPLAY_FOOTER_SIZE;
+  if (index < REPLAY_HEADER_SIZE || index > index_end - REPLAY_LENGTH_SIZE)
+    return false;
+  size_t length = read_u32(data + index);
+  const uint8_t *record = data + index + REPLAY_LENGTH_SIZE;
+  if (length != index_end - index - REPLAY_LENGTH_SIZE || length < 1 + 4 ||
+      record[0] != INDEX_TAG)
+    return false;
+  size_t count = read_u32(record + 1);
+  if (length != 1 + 4 + count * REPLAY_INDEX_ENTRY_SIZE)
+    return false;
+
+  const uint8_t *entry = record + 1 + 4;
+  for (size_t i = 0; i < count; ++i, entry += REPLAY_INDEX_ENTRY_SIZE) {
+    auto turn = read_integral<uint16_t>(entry);
+    auto offset = read_integral<uint64_t>(entry + 2);
+    if (offset < REPLAY_HEADER_SIZE || offset > index - REPLAY_LENGTH_SIZE ||
+        (!keyframes.empty() && keyframes.back().first >= turn)) {
+      keyframes.clear();
+      return false;
+    }
+    keyframes.emplace_back(turn, size_t(offset));
+  }
+  records_end = size_t(index);
+  return true;
+}
+
+void ReplayReader::scan_keyframes() {
+  size_t offset = REPLAY_HEADER_SIZE;
+  while (records_end - offset >= REPLAY_LENGTH_SIZE &&
+         records_end - offset - REPLAY_LENGTH_SIZE >= read_u32(data + offset)) {
+    record_t record(data + offset + REPLAY_LENGTH_SIZE, read_u32(data + offset));
+    if (!record.empty() && record[0] == KEYFRAME_TAG)
+      keyframes.emplace_back(turn_number(record), offset);
+    offset += REPLAY_LENGTH_SIZE + record.size();
+  }
+}
+
+ReplayReader::~ReplayReader() {
+  munmap(const_cast<uint8_t *>(data), size);
+}
+
+ReplayReader::iterator ReplayReader::begin() const {
+  return iterator(data + REPLAY_HEADER_SIZE, data + records_end);
+}
+
+ReplayReader::iterator ReplayReader::end() const {
+  return iterator(data + records_end, data + records_end);
+}
+
+ServerMessage ReplayReader::message(record_t record) {
+  BufferReader reader(record.data(), record.size());
+  try {
+    auto ret = deserialize_server_message(reader);
+    if (reader.position() != record.size())
+      throw InvalidReplay();
+    return ret;
+  } catch (const CouldNotDeserialize &) {
+    throw InvalidReplay();
+  }
+}
+
+std::pair<ReplayState, ReplayReader::iterator>
+ReplayReader::seek(uint16_t turn) const {
+  ReplayState state;
+  auto it = begin();
+  // Hello and GameStarted
+  for (; it != end() && !is_turn(*it); ++it)
+    state.apply(message(*it));
+
+  auto keyframe = std::upper_bound(
+      keyframes.begin(), keyframes.end(), turn,
+      [](uint16_t turn, const auto &keyframe) { return turn < keyframe.first; });
+  if (keyframe != keyframes.begin()) {
+    --keyframe;
+    size_t offset = keyframe->second;
+    record_t record(data + offset + REPLAY_LENGTH_SIZE, read_u32(data + offset));
+    if (offset + REPLAY_LENGTH_SIZE + record.size() > records_end)
+      throw InvalidReplay();
+    try {
+      state.decode(record);
+    } catch (const CouldNotDeserialize &) {
+      throw InvalidReplay();
+    }
+    it = iterator(record.data() + record.size(), data + records_end);
+  }
+
+  for (; it != end() && is_turn(*it) && turn_number(*it) <= turn; ++it)
+    state.apply(message(*it));
+  return {std::move(state), it};
+}
+
+ReplayReader::iterator::iterator(const uint8_t *begin, const uint8_t *end_)
+    : next(begin), end(end_) {
+  ++*this;
+}
+
+ReplayReader::iterator &ReplayReader::iterator::operator++() {
+  do {
+    size_t left = size_t(end - next);
+    if (left < REPLAY_LENGTH_SIZE ||
+        left - REPLAY_LENGTH_SIZE < read_u32(next)) {
+      // the end, the iterators compare by the record start
+      record = record_t(end, size_t(0));
+      next = end;
+      return *this;
+    }
+    size_t length = read_u32(next);
+    record = record_t(next + REPLAY_LENGTH_SIZE, length);
+    next += REPLAY_LENGTH_SIZE + length;
+    // the keyframes are skipped
+  } while (!record.empty() && record[0] >= KEYFRAME_TAG);
+  return *this;
+}
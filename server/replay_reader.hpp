@@ -0,0 +1,94 @@
+#ifndef __REPLAY_READER_HPP
+#define __REPLAY_READER_HPP
+
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "messages.hpp"
+#include "replay_state.hpp"
+
+struct InvalidReplay : public std::exception {
+  const char *what() const throw() { return "InvalidReplay"; }
+};
+
+// A replay file mapped into memory. The records are views into the mapping,
+// so iterating over them copies nothing. The keyframes are found with the
+// index at the end of the file, or with a scan of the records if the file
+// was not closed.
+class ReplayReader {
+public:
+  using record_t = std::span<const uint8_t>;
+
+  // throws InvalidReplay if the file cannot be mapped or is not a replay
+  explicit ReplayReader(const std::string &path);
+  ~ReplayReader();
+
+  ReplayReader(const ReplayReader &) = delete;
+  ReplayReader &operator=(const ReplayReader &) = delete;
+
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = record_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const record_t *;
+    using reference = const record_t &;
+
+    iterator() = default;
+
+    reference operator*() const { return record; }
+    pointer operator->() const { return &record; }
+    iterator &operator++();
+    iterator operator++(int) {
+      auto ret = *this;
+      ++*this;
+      return ret;
+    }
+    bool operator==(const iterator &other) const {
+      return record.data() == other.record.data();
+    }
+
+  private:
+    friend class ReplayReader;
+
+    // the rest of the records after the record
+    const uint8_t *next = nullptr;
+    const uint8_t *end = nullptr;
+    record_t record;
+
+    iterator(const uint8_t *begin, const uint8_t *end_);
+  };
+
+  // the records of the server messages, the ones of a truncated file end
+  // with the last complete one
+  iterator begin() const;
+  iterator end() const;
+
+  // decodes a record
+  static ServerMessage message(record_t record);
+
+  // the state after the given turn (or after the last one recorded before
+  // it) and the records that follow, applies at most keyframe_interval turns
+  std::pair<ReplayState, iterator> seek(uint16_t turn) const;
+
+  uint16_t keyframe_interval() const { return interval; }
+
+private:
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+  // the records end before the index
+  size_t records_end = 0;
+  uint16_t interval = 0;
+  // the turns and the offsets of the keyframes
+  std::vector<std::pair<uint16_t, size_t>> keyframes;
+
+  bool read_index();
+  void scan_keyframes();
+};
+
+#endif // __REPLAY_READER_HPP
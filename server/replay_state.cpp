@@ -0,0 +1,201 @@
+#include "replay_state.hpp"
+#include "deserialize.hpp"
+#include "reader.hpp"
+#include "replay_format.hpp"
+#include "serialize.hpp"
+
+namespace {
+
+template <std::integral T> void put(message_t &message, T x) {
+  for (size_t i = sizeof(T); i-- > 0;)
+    message.emplace_back(uint8_t(x >> (8 * i)));
+}
+
+void put(message_t &message, const message_t &x) {
+  message.insert(message.end(), x.begin(), x.end());
+}
+
+template <std::integral T> T get(Reader &reader) {
+  message_t bytes;
+  try {
+    bytes = reader.read(sizeof(T));
+  } catch (const InvalidTCPMessage &) {
+    throw CouldNotDeserialize();
+  }
+  T ret = 0;
+  for (auto byte : bytes)
+    ret = T(ret << 8 | byte);
+  return ret;
+}
+
+} // namespace
+
+void ReplayState::apply(const ServerMessage &message) {
+  if (std::holds_alternative<Hello>(message.m)) {
+    hello = std::get<Hello>(message.m);
+  } else if (std::holds_alternative<AcceptedPlayer>(message.m)) {
+    const auto &accepted_player = std::get<AcceptedPlayer>(message.m);
+    players[accepted_player.id] = accepted_player.player;
+    scores[accepted_player.id] = 0;
+  } else if (std::holds_alternative<GameStarted>(message.m)) {
+    players = std::get<GameStarted>(message.m).players;
+    for (const auto &[player_id, _player] : players)
+      scores[player_id] = 0;
+  } else if (std::holds_alternative<Turn>(message.m)) {
+    apply(std::get<Turn>(message.m));
+  } else { // GameEnded
+    players.clear();
+    player_positions.clear();
+    blocks.clear();
+    bombs.clear();
+    explosions.clear();
+    scores.clear();
+  }
+}
+
+void ReplayState::apply(const Turn &message) {
+  turn = message.turn;
+  explosions.clear();
+  std::map<BombId, Position> exploding_bombs;
+  for (auto it = bombs.begin(); it != bombs.end();) {
+    if (--it->second.timer == 0) {
+      exploding_bombs.emplace(it->first, it->second.position);
+      it = bombs.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  std::set<PlayerId> exploded_players;
+  for (const auto &event : message.events) {
+    if (std::holds_alternative<BombPlaced>(event.m)) {
+      const auto &bomb_placed = std::get<BombPlaced>(event.m);
+      bombs[bomb_placed.id] = Bomb{bomb_placed.position, hello.bomb_timer};
+    } else if (std::holds_alternative<BombExploded>(event.m)) {
+      const auto &bomb_exploded = std::get<BombExploded>(event.m);
+
+      Position position{};
+      if (exploding_bombs.contains(bomb_exploded.id))
+        position = exploding_bombs[bomb_exploded.id];
+      else if (bombs.contains(bomb_exploded.id))
+        position = bombs[bomb_exploded.id].position;
+      auto is_legal = [&](int x, int y) {
+        return x >= 0 && x < hello.size_x && y >= 0 && y < hello.size_y;
+      };
+      std::set<Position> exploded_blocks(bomb_exploded.blocks_destroyed.begin(),
+                                         bomb_exploded.blocks_destroyed.end());
+      for (auto [dx, dy] : std::vector<std::pair<int, int>>{
+               {1, 0}, {-1, 0}, {0, 1}, {0, -1}}) {
+        for (int i = 0; i <= hello.explosion_radius; ++i) {
+          int x = position.x + i * dx;
+          int y = position.y + i * dy;
+          if (!is_legal(x, y))
+            break;
+          explosions.emplace(x, y);
+          if (exploded_blocks.contains({uint16_t(x), uint16_t(y)}))
+            break;
+        }
+      }
+
+      bombs.erase(bomb_exploded.id);
+      for (const auto &robot : bomb_exploded.robots_destroyed)
+        exploded_players.emplace(robot);
+      for (const auto &block : bomb_exploded.blocks_destroyed)
+        blocks.erase(block);
+    } else if (std::holds_alternative<PlayerMoved>(event.m)) {
+      const auto &player_moved = std::get<PlayerMoved>(event.m);
+      player_positions[player_moved.id] = player_moved.position;
+    } else { // BlockPlaced
+      blocks.emplace(std::get<BlockPlaced>(event.m).position);
+    }
+  }
+  for (const auto &player_id : exploded_players)
+    ++scores[player_id];
+}
+
+// KEYFRAME_TAG, turn (u16), then the players, the player positions, the
+// blocks, the bombs, the explosions and the scores, each one a count (u32)
+// followed by the elements
+message_t ReplayState::encode() const {
+  message_t ret{KEYFRAME_TAG};
+  put(ret, turn);
+  put(ret, uint32_t(players.size()));
+  for (const auto &[id, player] : players) {
+    put(ret, id);
+    put(ret, serialize(player));
+  }
+  put(ret, uint32_t(player_positions.size()));
+  for (const auto &[id, position] : player_positions) {
+    put(ret, id);
+    put(ret, serialize(position));
+  }
+  put(ret, uint32_t(blocks.size()));
+  for (const auto &block : blocks)
+    put(ret, serialize(block));
+  put(ret, uint32_t(bombs.size()));
+  for (const auto &[id, bomb] : bombs) {
+    put(ret, id);
+    put(ret, serialize(bomb));
+  }
+  put(ret, uint32_t(explosions.size()));
+  for (const auto &explosion : explosions)
+    put(ret, serialize(explosion));
+  put(ret, uint32_t(scores.size()));
+  for (const auto &[id, score] : scores) {
+    put(ret, id);
+    put(ret, score);
+  }
+  return ret;
+}
+
+void ReplayState::decode(std::span<const uint8_t> keyframe) {
+  BufferReader reader(keyframe.data(), keyframe.size());
+  if (get<uint8_t>(reader) != KEYFRAME_TAG)
+    throw CouldNotDeserialize();
+  turn = get<uint16_t>(reader);
+  players.clear();
+  for (auto n = get<uint32_t>(reader); n > 0; --n) {
+    auto id = get<PlayerId>(reader);
+    players[id] = deserialize_player(reader);
+  }
+  player_positions.clear();
+  for (auto n = get<uint32_t>(reader); n > 0; --n) {
+    auto id = get<PlayerId>(reader);
+    player_positions[id] = deserialize_position(reader);
+  }
+  blocks.clear();
+  for (auto n = get<uint32_t>(reader); n > 0; --n)
+    blocks.emplace_hint(blocks.end(), deserialize_position(reader));
+  bombs.clear();
+  for (auto n = get<uint32_t>(reader); n > 0; --n) {
+    auto id = get<BombId>(reader);
+    bombs[id] = deserialize_bomb(reader);
+  }
+  explosions.clear();
+  for (auto n = get<uint32_t>(reader); n > 0; --n)
+    explosions.emplace_hint(explosions.end(), deserialize_position(reader));
+  scores.clear();
+  for (auto n = get<uint32_t>(reader); n > 0; --n) {
+    auto id = get<PlayerId>(reader);
+    scores[id] = get<Score>(reader);
+  }
+  if (reader.position() != keyframe.size())
+    throw CouldNotDeserialize();
+}
+
+Game ReplayState::game() const {
+  Game ret;
+  ret.server_name = hello.server_name;
+  ret.size_x = hello.size_x;
+  ret.size_y = hello.size_y;
+  ret.game_length = hello.game_length;
+  ret.turn = turn;
+  ret.players = players;
+  ret.player_positions = player_positions;
+  ret.blocks = std::vector<Position>(blocks.begin(), blocks.end());
+  for (const auto &[_id, bomb] : bombs)
+    ret.bombs.emplace_back(bomb);
+  ret.explosions = std::vector<Position>(explosions.begin(), explosions.end());
+  ret.scores = scores;
+  return ret;
+}
@@ -0,0 +1,37 @@
+#ifndef __REPLAY_STATE_HPP
+#define __REPLAY_STATE_HPP
+
+#include <map>
+#include <set>
+#include <span>
+
+#include "messages.hpp"
+
+// The state of a recorded game as a client sees it, rebuilt from the server
+// messages in the same way the client does it. Keyframes of a replay file
+// store it, so that a reader can start from them instead of the first turn.
+struct ReplayState {
+  Hello hello{};
+  std::map<PlayerId, Player> players;
+  uint16_t turn = 0;
+  std::map<PlayerId, Position> player_positions;
+  std::set<Position> blocks;
+  std::map<BombId, Bomb> bombs;
+  // the cells exploded in the last turn
+  std::set<Position> explosions;
+  std::map<PlayerId, Score> scores;
+
+  void apply(const ServerMessage &message);
+
+  // a keyframe record, everything but hello
+  message_t encode() const;
+  // throws CouldNotDeserialize
+  void decode(std::span<const uint8_t> keyframe);
+
+  Game game() const;
+
+private:
+  void apply(const Turn &turn);
+};
+
+#endif // __REPLAY_STATE_HPP
@@ -0,0 +1,136 @@
+#include <fstream>
+#include <iostream>
+
+#include "deserialize.hpp"
+#include "reader.hpp"
+#include "replay_format.hpp"
+#include "replay_state.hpp"
+#include "replay_writer.hpp"
+
+struct ReplayWriter::File {
+  std::string path;
+  // opened by the writer thread, the rest is used only by it as well
+  std::ofstream stream;
+  uint64_t offset = 0;
+  ReplayState state;
+  // the turns and the offsets of the keyframes
+  std::vector<std::pair<uint16_t, uint64_t>> keyframes;
+};
+
+namespace {
+
+template <std::integral T> void write_integral(std::ofstream &stream, T x) {
+  uint8_t bytes[sizeof(T)];
+  for (size_t i = 0; i < sizeof(T); ++i)
+    bytes[i] = uint8_t(x >> (8 * (sizeof(T) - 1 - i)));
+  stream.write(reinterpret_cast<const char *>(bytes), sizeof(bytes));
+}
+
+void write_record(std::ofstream &stream, const message_t &message) {
+  write_integral(stream, uint32_t(message.size()));
+  stream.write(reinterpret_cast<const char *>(message.data()),
+               std::streamsize(message.size()));
+}
+
+} // namespace
+
+ReplayWriter::ReplayWriter(uint16_t keyframe_interval_)
+    : keyframe_interval(keyframe_interval_), thread([this] { run(); }) {}
+
+ReplayWriter::~ReplayWriter() {
+  {
+    std::lock_guard<std::mutex> lock(tasks_mutex);
+    stopping = true;
+  }
+  tasks_available.notify_one();
+  thread.join();
+}
+
+ReplayWriter::file_t ReplayWriter::open(const std::string &path) {
+  auto file = std::make_shared<File>();
+  file->path = path;
+  return file;
+}
+
+void ReplayWriter::append(const file_t &file, shared_message_t message) {
+  push({file, std::move(message)});
+}
+
+void ReplayWriter::close(const file_t &file) { push({file, nullptr}); }
+
+void ReplayWriter::push(Task task) {
+  {
+    std::lock_guard<std::mutex> lock(tasks_mutex);
+    tasks.emplace_back(std::move(task));
+  }
+  tasks_available.notify_one();
+}
+
+void ReplayWriter::run() {
+  std::deque<Task> batch;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(tasks_mutex);
+      tasks_available.wait(lock, [this] { return stopping || !tasks.empty(); });
+      if (tasks.empty())
+        return;
+      batch.swap(tasks);
+    }
+    for (auto &[file, message] : batch) {
+      auto &stream = file->stream;
+      if (!stream.is_open() && !file->path.empty()) {
+        stream.open(file->path, std::ios::binary | std::ios::trunc);
+        if (!stream) {
+          std::cerr << "Could not open the replay file " << file->path
+                    << std::endl;
+        }
+        stream.write(reinterpret_cast<const char *>(REPLAY_MAGIC.data()),
+                     REPLAY_MAGIC.size());
+        write_integral(stream, REPLAY_VERSION);
+        write_integral(stream, keyframe_interval);
+        file->offset = REPLAY_HEADER_SIZE;
+        // the file is not opened again after it is closed
+        file->path.clear();
+      }
+      if (message)
+        write(*file, *message);
+      else
+        finish(*file);
+    }
+    batch.clear();
+  }
+}
+
+void ReplayWriter::write(File &file, const message_t &message) {
+  write_record(file.stream, message);
+  file.offset += REPLAY_LENGTH_SIZE + message.size();
+
+  BufferReader reader(message.data(), message.size());
+  try {
+    file.state.apply(deserialize_server_message(reader));
+  } catch (const CouldNotDeserialize &) {
+    return;
+  }
+  bool is_turn = message[0] == TURN_TAG;
+  if (is_turn && file.state.turn > 0 &&
+      file.state.turn % keyframe_interval == 0) {
+    auto keyframe = file.state.encode();
+    file.keyframes.emplace_back(file.state.turn, file.offset);
+    write_record(file.stream, keyframe);
+    file.offset += REPLAY_LENGTH_SIZE + keyframe.size();
+  }
+}
+
+void ReplayWriter::finish(File &file) {
+  auto &stream = file.stream;
+  write_integral(stream, uint32_t(1 + 4 + file.keyframes.size() *
+                                              REPLAY_INDEX_ENTRY_SIZE));
+  write_integral(stream, INDEX_TAG);
+  write_integral(stream, uint32_t(file.keyframes.size()));
+  for (const auto &[turn, offset] : file.keyframes) {
+    write_integral(stream, turn);
+    write_integral(stream, offset);
+  }
+  write_integral(stream, file.offset);
+  stream.close();
+}
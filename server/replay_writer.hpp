@@ -0,0 +1,56 @@
+#ifndef __REPLAY_WRITER_HPP
+#define __REPLAY_WRITER_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "messages.hpp"
+
+// Writes replay files on a thread of its own, so that rooms never wait for
+// the disk. The messages of a file are written in the order they were
+// appended. The writer thread also follows the state of every game to write
+// the keyframes.
+class ReplayWriter {
+public:
+  struct File;
+  using file_t = std::shared_ptr<File>;
+  using shared_message_t = std::shared_ptr<const message_t>;
+
+  // a keyframe is written after every keyframe_interval turns
+  explicit ReplayWriter(uint16_t keyframe_interval_);
+  // writes everything that was appended before
+  ~ReplayWriter();
+
+  ReplayWriter(const ReplayWriter &) = delete;
+  ReplayWriter &operator=(const ReplayWriter &) = delete;
+
+  // creates a replay file, errors are reported by the writer thread
+  file_t open(const std::string &path);
+  void append(const file_t &file, shared_message_t message);
+  void close(const file_t &file);
+
+private:
+  struct Task {
+    file_t file;
+    // closes the file if empty
+    shared_message_t message;
+  };
+
+  uint16_t keyframe_interval;
+  std::deque<Task> tasks;
+  std::mutex tasks_mutex;
+  std::condition_variable tasks_available;
+  bool stopping = false;
+  std::thread thread;
+
+  void push(Task task);
+  void run();
+  void write(File &file, const message_t &message);
+  void finish(File &file);
+};
+
+#endif // __REPLAY_WRITER_HPP
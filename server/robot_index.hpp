@@ -0,0 +1,75 @@
+#ifndef __ROBOT_INDEX_HPP
+#define __ROBOT_INDEX_HPP
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "board.hpp"
+#include "messages.hpp"
+
+// Robot positions together with a cell -> robots index, so that the robots
+// standing on a given cell are found with a single lookup. The occupied cells
+// are also kept on a bitboard, so that the common lookup of an empty cell
+// does not even hash and explosions skip the empty cells of their rays.
+class RobotIndex {
+public:
+  void place(PlayerId id, const Position &position) {
+    auto it = positions.find(id);
+    if (it != positions.end()) {
+      if (it->second == position)
+        return;
+      remove_from_cell(id, it->second);
+      it->second = position;
+    } else {
+      positions.emplace(id, position);
+    }
+    auto &robots = cells[key(position)];
+    occupied.emplace(position);
+    robots.insert(std::lower_bound(robots.begin(), robots.end(), id), id);
+  }
+
+  const Position &position(PlayerId id) const { return positions.at(id); }
+
+  const std::map<PlayerId, Position> &all() const { return positions; }
+
+  // robots standing on the given cell, in increasing id order
+  const std::vector<PlayerId> &at(const Position &position) const {
+    static const std::vector<PlayerId> empty;
+    if (!occupied.contains(position))
+      return empty;
+    auto it = cells.find(key(position));
+    return it == cells.end() ? empty : it->second;
+  }
+
+  // the cells with at least one robot
+  const Bitboard &occupied_cells() const { return occupied; }
+
+  void clear() {
+    positions.clear();
+    cells.clear();
+    occupied.clear();
+  }
+
+private:
+  std::map<PlayerId, Position> positions;
+  std::unordered_map<uint32_t, std::vector<PlayerId>> cells;
+  Bitboard occupied;
+
+  static uint32_t key(const Position &position) {
+    return uint32_t(position.x) << 16 | position.y;
+  }
+
+  void remove_from_cell(PlayerId id, const Position &position) {
+    auto it = cells.find(key(position));
+    auto &robots = it->second;
+    robots.erase(std::lower_bound(robots.begin(), robots.end(), id));
+    if (robots.empty()) {
+      cells.erase(it);
+      occupied.erase(position);
+    }
+  }
+};
+
+#endif // __ROBOT_INDEX_HPP
@@ -0,0 +1,386 @@
+// boost/asio/awaitable.hpp uses std::exchange without including <utility>
+#include <utility>
+
+#include <algorithm>
+#include <array>
+#include <boost/asio.hpp>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <sys/resource.h>
+
+#include "deserialize.hpp"
+#include "loadgen_options.hpp"
+#include "messages.hpp"
+#include "reader.hpp"
+#include "serialize.hpp"
+
+using boost::asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// A script action, no action if empty.
+using Action = std::optional<ClientMessage>;
+
+std::vector<Action> read_script(const std::string &path) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Could not open the script " << path << std::endl;
+    exit(1);
+  }
+  std::vector<Action> ret;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line == "up")
+      ret.emplace_back(ClientMessage{Move{Up}});
+    else if (line == "right")
+      ret.emplace_back(ClientMessage{Move{Right}});
+    else if (line == "down")
+      ret.emplace_back(ClientMessage{Move{Down}});
+    else if (line == "left")
+      ret.emplace_back(ClientMessage{Move{Left}});
+    else if (line == "bomb")
+      ret.emplace_back(ClientMessage{PlaceBomb{}});
+    else if (line == "block")
+      ret.emplace_back(ClientMessage{PlaceBlock{}});
+    else if (line == "wait")
+      ret.emplace_back(std::nullopt);
+    else if (!line.empty()) {
+      std::cerr << "Invalid action in the script: " << line << std::endl;
+      exit(1);
+    }
+  }
+  if (ret.empty()) {
+    std::cerr << "The script " << path << " is empty" << std::endl;
+    exit(1);
+  }
+  return ret;
+}
+
+// Measurements of all the connections. Everything runs on a single thread.
+struct Stats {
+  size_t connected = 0;
+  size_t failed = 0;
+  size_t disconnected = 0;
+  size_t messages = 0;
+  size_t actions_sent = 0;
+  // the last turn received live in every game being played, by the address
+  // of its first player, which tells apart the games of different rooms
+  std::map<std::string, uint16_t> latest_turns;
+  std::vector<double> catch_up_us;
+  std::vector<double> turn_intervals_us;
+};
+
+// A client that joins the game and sends an action after every turn.
+class Connection : public std::enable_shared_from_this<Connection> {
+public:
+  Connection(boost::asio::io_context &io_context, Stats &stats_,
+             const LoadgenOptions &options_,
+             const std::vector<Action> &script_, bool is_player_,
+             uint32_t seed)
+      : socket(io_context), stats(stats_), options(options_), script(script_),
+        is_player(is_player_), random(seed), script_position(seed) {}
+
+  void start(const tcp::endpoint &endpoint) {
+    connect_time = Clock::now();
+    // the replay ends with the turn that is live now in the game of the
+    // room, which is known once the replay gets to GameStarted
+    live_turns = stats.latest_turns;
+    socket.async_connect(endpoint, [self = shared_from_this()](
+                                       const boost::system::error_code &error) {
+      if (error) {
+        ++self->stats.failed;
+        return;
+      }
+      ++self->stats.connected;
+      boost::system::error_code ignored;
+      self->socket.set_option(tcp::no_delay(true), ignored);
+      if (self->is_player)
+        self->send(ClientMessage{Join{self->options.player_name}});
+      self->read();
+    });
+  }
+
+  size_t bytes_received() const { return received; }
+
+private:
+  static constexpr size_t READ_BUFFER_SIZE = 4096;
+
+  tcp::socket socket;
+  Stats &stats;
+  const LoadgenOptions &options;
+  const std::vector<Action> &script;
+  bool is_player;
+  std::minstd_rand random;
+  size_t script_position;
+
+  std::array<uint8_t, READ_BUFFER_SIZE> read_buffer;
+  message_t pending;
+  size_t received = 0;
+
+  Clock::time_point connect_time;
+  std::map<std::string, uint16_t> live_turns;
+  std::optional<Clock::time_point> hello_time;
+  // the first player of the current game
+  std::string game;
+  std::optional<uint16_t> catch_up_turn;
+  bool caught_up = false;
+  std::optional<Clock::time_point> last_turn_time;
+
+  std::shared_ptr<message_t> writing;
+
+  void read() {
+    socket.async_read_some(
+        boost::asio::buffer(read_buffer),
+        [self = shared_from_this()](const boost::system::error_code &error,
+                                    size_t len) {
+          if (error) {
+            ++self->stats.disconnected;
+            return;
+          }
+          self->handle_read(len);
+        });
+  }
+
+  void handle_read(size_t len) {
+    auto now = Clock::now();
+    received += len;
+    pending.insert(pending.end(), read_buffer.begin(),
+                   read_buffer.begin() + ptrdiff_t(len));
+    size_t consumed = 0;
+    for (;;) {
+      BufferReader reader(pending.data() + consumed,
+                          pending.size() - consumed);
+      try {
+        auto server_message = deserialize_server_message(reader);
+        consumed += reader.position();
+        handle_message(server_message, now);
+      } catch (const CouldNotDeserialize &) {
+        if (reader.is_exhausted())
+          break;
+        std::cerr << "Invalid server message" << std::endl;
+        exit(1);
+      }
+    }
+    pending.erase(pending.begin(), pending.begin() + ptrdiff_t(consumed));
+    read();
+  }
+
+  void handle_message(const ServerMessage &server_message,
+                      Clock::time_point now) {
+    ++stats.messages;
+    if (std::holds_alternative<Hello>(server_message.m)) {
+      hello_time = now;
+      if (live_turns.empty())
+        finish_catch_up(now);
+    } else if (std::holds_alternative<GameStarted>(server_message.m)) {
+      const auto &players = std::get<GameStarted>(server_message.m).players;
+      game = players.empty() ? "" : players.begin()->second.address;
+      if (!caught_up) {
+        auto it = live_turns.find(game);
+        // the room was gathering players, the catch-up ended with the Hello
+        if (it == live_turns.end())
+          finish_catch_up(*hello_time);
+        else
+          catch_up_turn = it->second;
+      }
+    } else if (std::holds_alternative<Turn>(server_message.m)) {
+      auto turn = std::get<Turn>(server_message.m).turn;
+      if (!caught_up && catch_up_turn && turn >= *catch_up_turn)
+        finish_catch_up(now);
+      if (!caught_up)
+        return;
+      if (last_turn_time) {
+        stats.turn_intervals_us.emplace_back(
+            std::chrono::duration<double, std::micro>(now - *last_turn_time)
+                .count());
+      }
+      last_turn_time = now;
+      auto [it, added] = stats.latest_turns.emplace(game, turn);
+      if (!added && turn > it->second)
+        it->second = turn;
+      if (is_player)
+        act();
+    } else if (std::holds_alternative<GameEnded>(server_message.m)) {
+      if (!caught_up)
+        finish_catch_up(now);
+      last_turn_time.reset();
+      stats.latest_turns.erase(game);
+      if (is_player)
+        send(ClientMessage{Join{options.player_name}});
+    }
+  }
+
+  void finish_catch_up(Clock::time_point now) {
+    caught_up = true;
+    stats.catch_up_us.emplace_back(
+        std::chrono::duration<double, std::micro>(now - connect_time)
+            .count());
+  }
+
+  void act() {
+    if (!script.empty()) {
+      const auto &action = script[script_position++ % script.size()];
+      if (action)
+        send(*action);
+      return;
+    }
+    switch (random() % 6) {
+    case 0:
+      send(ClientMessage{PlaceBomb{}});
+      break;
+    case 1:
+      send(ClientMessage{PlaceBlock{}});
+      break;
+    default:
+      send(ClientMessage{Move{Direction(random() % 4)}});
+    }
+  }
+
+  // the server only keeps the latest action, so an action is dropped if the
+  // previous one is still being written
+  void send(const ClientMessage &client_message) {
+    if (writing)
+      return;
+    writing = std::make_shared<message_t>(serialize(client_message));
+    ++stats.actions_sent;
+    boost::asio::async_write(
+        socket, boost::asio::buffer(*writing),
+        [self = shared_from_this()](const boost::system::error_code &,
+                                    size_t) { self->writing.reset(); });
+  }
+};
+
+// every connection needs a file descriptor
+void raise_open_files_limit() {
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+}
+
+template <typename T> void print_summary(std::vector<T> values) {
+  std::sort(values.begin(), values.end());
+  auto percentile = [&](double p) {
+    return values.empty() ? T(0)
+                          : values[size_t(p * double(values.size() - 1))];
+  };
+  double sum = 0;
+  for (auto value : values)
+    sum += double(value);
+  std::cout << "{\"count\": " << values.size() << ", \"mean\": "
+            << (values.empty() ? 0 : sum / double(values.size()))
+            << ", \"min\": " << percentile(0) << ", \"p50\": "
+            << percentile(0.5) << ", \"p90\": " << percentile(0.9)
+            << ", \"p99\": " << percentile(0.99) << ", \"max\": "
+            << percentile(1) << "}";
+}
+
+void print_results(const Stats &stats,
+                   const std::vector<std::shared_ptr<Connection>> &connections,
+                   double elapsed_s) {
+  std::vector<size_t> bytes_received;
+  for (const auto &connection : connections)
+    bytes_received.emplace_back(connection->bytes_received());
+  // jitter is the deviation from the typical interval between turns
+  auto intervals = stats.turn_intervals_us;
+  std::sort(intervals.begin(), intervals.end());
+  double period = intervals.empty() ? 0 : intervals[intervals.size() / 2];
+  std::vector<double> jitter;
+  for (auto interval : intervals)
+    jitter.emplace_back(std::abs(interval - period));
+
+  std::cout << "{\n  \"connections\": " << connections.size()
+            << ",\n  \"connected\": " << stats.connected
+            << ",\n  \"failed\": " << stats.failed
+            << ",\n  \"disconnected\": " << stats.disconnected
+            << ",\n  \"elapsed_s\": " << elapsed_s
+            << ",\n  \"messages\": " << stats.messages
+            << ",\n  \"actions_sent\": " << stats.actions_sent
+            << ",\n  \"bytes_received\": ";
+  print_summary(bytes_received);
+  std::cout << ",\n  \"catch_up_us\": ";
+  print_summary(stats.catch_up_us);
+  std::cout << ",\n  \"turn_interval_us\": ";
+  print_summary(stats.turn_intervals_us);
+  std::cout << ",\n  \"turn_jitter_us\": ";
+  print_summary(jitter);
+  std::cout << "\n}" << std::endl;
+}
+
+void open_connections(boost::asio::steady_timer &timer,
+                      boost::asio::io_context &io_context, Stats &stats,
+                      const LoadgenOptions &options,
+                      const std::vector<Action> &script,
+                      const tcp::endpoint &endpoint,
+                      std::vector<std::shared_ptr<Connection>> &connections,
+                      Clock::time_point start) {
+  // opening the connections that are due by now
+  std::chrono::duration<double> elapsed = Clock::now() - start;
+  std::chrono::duration<double> ramp_up = std::chrono::seconds(options.ramp_up);
+  size_t due = options.connections;
+  if (elapsed < ramp_up) {
+    due = size_t(double(options.connections) * (elapsed / ramp_up));
+  }
+  while (connections.size() < std::max(due, size_t(1)) &&
+         connections.size() < options.connections) {
+    auto index = uint32_t(connections.size());
+    bool is_player = index < options.connections - options.spectators;
+    connections.emplace_back(std::make_shared<Connection>(
+        io_context, stats, options, script, is_player, options.seed + index));
+    connections.back()->start(endpoint);
+  }
+  if (connections.size() == options.connections)
+    return;
+  timer.expires_after(std::chrono::milliseconds(1));
+  timer.async_wait([&, start](const boost::system::error_code &) {
+    open_connections(timer, io_context, stats, options, script, endpoint,
+                     connections, start);
+  });
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  auto options = get_loadgen_options(argc, argv);
+  raise_open_files_limit();
+  std::vector<Action> script;
+  if (!options.script.empty())
+    script = read_script(options.script);
+
+  boost::asio::io_context io_context;
+  tcp::endpoint endpoint;
+  try {
+    tcp::resolver resolver(io_context);
+    endpoint = *resolver
+                    .resolve(options.server_address,
+                             std::to_string(options.server_port))
+                    .begin();
+  } catch (...) {
+    std::cerr << "Could not resolve the server address" << std::endl;
+    exit(1);
+  }
+
+  Stats stats;
+  std::vector<std::shared_ptr<Connection>> connections;
+  auto start = Clock::now();
+  boost::asio::steady_timer ramp_up_timer(io_context);
+  open_connections(ramp_up_timer, io_context, stats, options, script,
+                   endpoint, connections, start);
+
+  boost::asio::steady_timer duration_timer(io_context);
+  duration_timer.expires_after(std::chrono::seconds(options.duration));
+  duration_timer.async_wait(
+      [&](const boost::system::error_code &) { io_context.stop(); });
+  io_context.run();
+
+  print_results(
+      stats, connections,
+      std::chrono::duration<double>(Clock::now() - start).count());
+}
@@ -0,0 +1,145 @@
+// boost/asio/awaitable.hpp uses std::exchange without including <utility>
+#include <utility>
+
+#include <array>
+#include <boost/asio.hpp>
+#include <iostream>
+
+#include "replay_format.hpp"
+#include "replay_options.hpp"
+#include "replay_reader.hpp"
+
+using boost::asio::ip::tcp;
+
+namespace {
+
+// Sends a recorded game to a client at the pace of a live server. The
+// records are written straight from the mapped file.
+class Playback : public std::enable_shared_from_this<Playback> {
+public:
+  Playback(tcp::socket socket_, const ReplayReader &replay_,
+           std::chrono::milliseconds turn_duration_)
+      : socket(std::move(socket_)), timer(socket.get_executor()),
+        replay(replay_), turn_duration(turn_duration_),
+        next_record(replay.begin()) {}
+
+  void start() {
+    read();
+    deadline = std::chrono::steady_clock::now();
+    send_next();
+  }
+
+private:
+  tcp::socket socket;
+  boost::asio::steady_timer timer;
+  const ReplayReader &replay;
+  std::chrono::milliseconds turn_duration;
+  ReplayReader::iterator next_record;
+  std::chrono::steady_clock::time_point deadline;
+  bool started = false;
+  bool closed = false;
+  std::array<uint8_t, 512> read_buffer;
+
+  // the client messages are ignored, reading only detects disconnection
+  void read() {
+    socket.async_read_some(
+        boost::asio::buffer(read_buffer),
+        [self = shared_from_this()](const boost::system::error_code &error,
+                                    size_t) {
+          if (error) {
+            self->close();
+            return;
+          }
+          self->read();
+        });
+  }
+
+  void send_next() {
+    if (closed || next_record == replay.end())
+      return;
+    auto record = *next_record;
+    bool is_timed =
+        !record.empty() &&
+        (record[0] == TURN_TAG || record[0] == GAME_ENDED_TAG);
+    // turn 0 is sent together with GameStarted
+    if (is_timed && started) {
+      deadline += turn_duration;
+      timer.expires_at(deadline);
+      timer.async_wait([self = shared_from_this()](
+                           const boost::system::error_code &) {
+        self->write();
+      });
+      return;
+    }
+    if (is_timed)
+      started = true;
+    write();
+  }
+
+  void write() {
+    if (closed)
+      return;
+    auto record = *next_record++;
+    boost::asio::async_write(
+        socket, boost::asio::buffer(record.data(), record.size()),
+        [self = shared_from_this()](const boost::system::error_code &error,
+                                    size_t) {
+          if (error) {
+            self->close();
+            return;
+          }
+          self->send_next();
+        });
+  }
+
+  void close() {
+    closed = true;
+    timer.cancel();
+    boost::system::error_code ignored;
+    socket.close(ignored);
+  }
+};
+
+void accept(tcp::acceptor &acceptor, const ReplayReader &replay,
+            std::chrono::milliseconds turn_duration) {
+  acceptor.async_accept([&, turn_duration](
+                            const boost::system::error_code &error,
+                            tcp::socket socket) {
+    if (!error) {
+      boost::system::error_code ignored;
+      socket.set_option(tcp::no_delay(true), ignored);
+      std::make_shared<Playback>(std::move(socket), replay, turn_duration)
+          ->start();
+    }
+    accept(acceptor, replay, turn_duration);
+  });
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  auto replay_options = get_replay_options(argc, argv);
+
+  std::unique_ptr<ReplayReader> replay;
+  try {
+    replay = std::make_unique<ReplayReader>(replay_options.file);
+  } catch (const InvalidReplay &) {
+    std::cerr << "Could not read the replay " << replay_options.file
+              << std::endl;
+    exit(1);
+  }
+
+  boost::asio::io_context io_context;
+  std::unique_ptr<tcp::acceptor> acceptor;
+  try {
+    acceptor = std::make_unique<tcp::acceptor>(tcp::acceptor(
+        io_context, tcp::endpoint(tcp::v6(), replay_options.port)));
+  } catch (...) {
+    std::cerr << "Could not bind to the given port" << std::endl;
+    exit(1);
+  }
+
+  accept(*acceptor, *replay,
+         std::chrono::milliseconds(replay_options.turn_duration));
+  io_context.run();
+}
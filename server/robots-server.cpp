@@ -1,340 +1,323 @@
-#include <array>
-#include <boost/lexical_cast.hpp>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
-#include <random>
-#include <set>
-#include <shared_mutex>
+#include <sys/resource.h>
+#include <unistd.h>
 
-#include "deserialize.hpp"
-#include "messages.hpp"
-#include "serialize.hpp"
+#include "metrics.hpp"
+#include "metrics_server.hpp"
+#include "room.hpp"
 #include "server_options.hpp"
+#include "session.hpp"
+#include "trace.hpp"
+#include "uring_transport.hpp"
 
 using boost::asio::ip::tcp;
-using socket_t = std::shared_ptr<tcp::socket>;
-using Lock = std::lock_guard<std::mutex>;
-using WLock = std::shared_lock<std::shared_mutex>;
-using RLock = std::unique_lock<std::shared_mutex>;
 
-std::set<socket_t> clients;
-std::mutex clients_mutex;
-std::map<socket_t, ClientMessage> client_messages;
-std::mutex client_messages_mutex;
-// stops the main thread so that new clients can relay previous server messages
-std::shared_mutex catching_up_mutex;
-
-// previous server messages
-Hello hello;
-std::vector<AcceptedPlayer> accepted_players;
-GameStarted game_started;
-std::vector<Turn> turns;
+// the first room that is still gathering players, or the least crowded one
+Room &choose_room(std::vector<std::unique_ptr<Room>> &rooms) {
+  for (auto &room : rooms) {
+    if (room->is_open())
+      return *room;
+  }
+  return **std::min_element(rooms.begin(), rooms.end(),
+                            [](const auto &a, const auto &b) {
+                              return a->clients_count() < b->clients_count();
+                            });
+}
 
-bool is_lobby = true;
+// A listening socket with an event loop and a thread of its own. Several of
+// them share the port with SO_REUSEPORT, so that the kernel spreads the
+// connections among them.
+struct Acceptor {
+  boost::asio::io_context io_context;
+  tcp::acceptor acceptor;
+  std::thread thread;
 
-template <typename T> void send(socket_t socket, const T &message) {
-  try {
-    boost::asio::write(*socket,
-                       boost::asio::buffer(serialize(ServerMessage{message})));
-  } catch (...) {
+  // throws boost::system::system_error if the port cannot be bound
+  Acceptor(uint16_t port, bool reuse_port) : acceptor(io_context) {
+    tcp::endpoint endpoint(tcp::v6(), port);
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(tcp::acceptor::reuse_address(true));
+    if (reuse_port)
+      acceptor.set_option(
+          boost::asio::detail::socket_option::boolean<SOL_SOCKET,
+                                                      SO_REUSEPORT>(true));
+    acceptor.bind(endpoint);
+    acceptor.listen();
   }
+};
+
+// the sessions run on the io_context, not on the loop of the acceptor
+void accept(tcp::acceptor &acceptor, boost::asio::io_context &io_context,
+            std::vector<std::unique_ptr<Room>> &rooms,
+            const ServerOptions &server_options) {
+  acceptor.async_accept(
+      boost::asio::make_strand(io_context),
+      [&](const boost::system::error_code &error, tcp::socket socket) {
+        if (!error) {
+          metrics::add(metrics::Counter::Accepts);
+          boost::system::error_code ignored;
+          socket.set_option(tcp::no_delay(true), ignored);
+          auto &room = choose_room(rooms);
+          std::make_shared<Session>(
+              std::make_unique<AsioTransport>(std::move(socket)), room,
+              server_options)
+              ->start();
+        }
+        accept(acceptor, io_context, rooms, server_options);
+      });
 }
 
-// assumes that the caller acquired the clients_mutex
-template <typename T> void send_to_all_clients(const T &message) {
-  for (const auto &client : clients) {
-    send(client, message);
-  }
+// the connections accepted by an io_uring are handled by it as well
+void accept(UringLoop &loop, bool reuse_port,
+            std::vector<std::unique_ptr<Room>> &rooms,
+            const ServerOptions &server_options) {
+  loop.listen(server_options.port, reuse_port, [&](int fd) {
+    metrics::add(metrics::Counter::Accepts);
+    auto &room = choose_room(rooms);
+    std::make_shared<Session>(std::make_unique<UringTransport>(fd, loop),
+                              room, server_options)
+        ->start();
+  });
 }
 
-void handle_connection(socket_t socket) {
-  // sending previous server messages
-  {
-    WLock w_lock(catching_up_mutex);
-    send(socket, hello);
-    if (is_lobby) {
-      for (const auto &accepted_player : accepted_players)
-        send(socket, accepted_player);
-    } else {
-      send(socket, game_started);
-      for (const auto &turn : turns)
-        send(socket, turn);
+// a loop per acceptor, none if the kernel does not support io_uring and the
+// server falls back to asio
+std::vector<std::unique_ptr<UringLoop>>
+make_uring_loops(boost::asio::io_context &io_context,
+                 const ServerOptions &options) {
+  std::vector<std::unique_ptr<UringLoop>> ret;
+  if (options.transport != TransportType::Uring)
+    return ret;
+  if (Uring::supported()) {
+    try {
+      for (uint16_t i = 0; i < options.acceptors; ++i)
+        ret.emplace_back(std::make_unique<UringLoop>(io_context));
+      return ret;
+    } catch (const std::system_error &) {
+      ret.clear();
     }
-    Lock lock(clients_mutex);
-    clients.emplace(socket);
   }
-  // listening for client messages
-  TCPReader tcp_reader(*socket);
-  for (;;) {
-    try {
-      auto client_message = deserialize_client_message(tcp_reader);
-      Lock lock(client_messages_mutex);
-      client_messages[socket] = client_message;
-    } catch (...) {
-      Lock lock(clients_mutex);
-      clients.erase(socket);
+  std::cerr << "io_uring is not supported, falling back to asio" << std::endl;
+  return ret;
+}
+
+// the resident set size of the process, in bytes
+size_t resident_memory() {
+  // the second field of statm is the resident set size in pages
+  size_t pages = 0, resident = 0;
+  std::ifstream("/proc/self/statm") >> pages >> resident;
+  return resident * size_t(sysconf(_SC_PAGESIZE));
+}
+
+// The memory per connection is the growth of the resident memory since
+// idle_memory, measured before accepting any connection, divided by the open
+// connections. writes and accepts count the write system calls and the
+// connections accepted by the last report.
+void report_stats(boost::asio::steady_timer &timer, uint16_t interval,
+                  size_t idle_memory, uint64_t writes = 0,
+                  uint64_t accepts = 0) {
+  timer.expires_after(std::chrono::seconds(interval));
+  timer.async_wait([&timer, interval, idle_memory, writes,
+                    accepts](const boost::system::error_code &) {
+    auto connections = Session::count();
+    auto memory = resident_memory();
+    size_t memory_per_connection =
+        connections == 0 || memory < idle_memory
+            ? 0
+            : (memory - idle_memory) / connections;
+    auto total_writes = metrics::total(metrics::Counter::Writes);
+    auto total_accepts = metrics::total(metrics::Counter::Accepts);
+    double writes_per_client =
+        connections == 0 ? 0
+                         : double(total_writes - writes) / interval /
+                               double(connections);
+    std::cerr << "Connections: " << connections
+              << ", memory per connection: " << memory_per_connection
+              << " bytes, slow consumers: " << Session::slow_consumers_count()
+              << ", dropped inputs: " << Session::dropped_inputs_count()
+              << ", input contentions: " << Session::input_contentions_count()
+              << ", writes per client per second: " << writes_per_client
+              << ", accepts per second: "
+              << double(total_accepts - accepts) / interval << std::endl;
+    report_stats(timer, interval, idle_memory, total_writes, total_accepts);
+  });
+}
+
+void write_gauges(std::ostream &out,
+                  std::vector<std::unique_ptr<Room>> &rooms) {
+  auto header = [&](const char *name, const char *type, const char *help) {
+    out << "# HELP " << name << " " << help << "\n# TYPE " << name << " "
+        << type << "\n";
+  };
+  auto per_room = [&](const char *name, const char *help, auto value) {
+    header(name, "gauge", help);
+    for (auto &room : rooms)
+      out << name << "{room=\"" << &room - &rooms[0] << "\"} " << value(*room)
+          << "\n";
+  };
+
+  header("robots_connections", "gauge", "Open client connections.");
+  out << "robots_connections " << Session::count() << "\n";
+  header("robots_slow_consumers_total", "counter",
+         "Times the slow consumer policy was applied.");
+  out << "robots_slow_consumers_total " << Session::slow_consumers_count()
+      << "\n";
+  header("robots_dropped_inputs_total", "counter",
+         "Actions overwritten before the room took them.");
+  out << "robots_dropped_inputs_total " << Session::dropped_inputs_count()
+      << "\n";
+  header("robots_input_contentions_total", "counter",
+         "Times a client and its room accessed its action at once.");
+  out << "robots_input_contentions_total "
+      << Session::input_contentions_count() << "\n";
+
+  header("robots_resident_memory_bytes", "gauge", "Resident memory size.");
+  out << "robots_resident_memory_bytes " << resident_memory() << "\n";
+
+  per_room("robots_room_clients", "Clients connected to the room.",
+           [](Room &room) { return room.clients_count(); });
+  per_room("robots_room_players", "Players accepted in the room.",
+           [](Room &room) { return room.players_count(); });
+  per_room("robots_room_turn", "The current turn of the room.",
+           [](Room &room) { return room.turn(); });
+  per_room("robots_room_lobby", "Whether the room is gathering players.",
+           [](Room &room) { return int(room.in_lobby()); });
+}
+
+void dump_trace(const std::string &path) {
+  if (!trace::dump(path))
+    std::cerr << "Could not write the trace to " << path << std::endl;
+}
+
+// SIGUSR1 dumps the trace, SIGINT and SIGTERM stop the server, which dumps it
+// on its way out
+void handle_trace_signals(boost::asio::signal_set &signals,
+                          const std::string &path,
+                          std::function<void()> stop) {
+  signals.async_wait([&signals, &path, stop](
+                         const boost::system::error_code &error, int signal) {
+    if (error)
+      return;
+    if (signal != SIGUSR1) {
+      stop();
       return;
     }
-  }
+    dump_trace(path);
+    handle_trace_signals(signals, path, stop);
+  });
 }
 
-void init_hello(const ServerOptions &server_options) {
-  hello.server_name = server_options.server_name;
-  hello.players_count = uint8_t(server_options.players_count);
-  hello.size_x = server_options.size_x;
-  hello.size_y = server_options.size_y;
-  hello.game_length = server_options.game_length;
-  hello.explosion_radius = server_options.explosion_radius;
-  hello.bomb_timer = server_options.bomb_timer;
+// every connection needs a file descriptor
+void raise_open_files_limit() {
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
 }
 
 int main(int argc, char **argv) {
   auto server_options = get_server_options(argc, argv);
-  init_hello(server_options);
+  raise_open_files_limit();
 
   boost::asio::io_context io_context;
-  std::unique_ptr<tcp::acceptor> acceptor;
+  // the sessions are started by the acceptors from their own loops
+  auto io_context_guard = boost::asio::make_work_guard(io_context);
+  auto uring_loops = make_uring_loops(io_context, server_options);
+  bool reuse_port = server_options.acceptors > 1;
+  std::vector<std::unique_ptr<Acceptor>> acceptors;
   try {
-    acceptor = std::make_unique<tcp::acceptor>(tcp::acceptor(
-        io_context, tcp::endpoint(tcp::v6(), server_options.port)));
+    for (uint16_t i = 0; i < server_options.acceptors && uring_loops.empty();
+         ++i)
+      acceptors.emplace_back(
+          std::make_unique<Acceptor>(server_options.port, reuse_port));
   } catch (...) {
     std::cerr << "Could not bind to the given port" << std::endl;
     exit(1);
   }
-  std::thread acceptor_thread{[&] {
-    for (;;) {
-      auto socket = std::make_shared<tcp::socket>(tcp::socket(io_context));
-      acceptor->accept(*socket);
-      socket->set_option(tcp::no_delay(true));
-      std::thread handle_connection_thread{handle_connection,
-                                           std::move(socket)};
-      handle_connection_thread.detach();
-    }
-  }};
-
-  std::minstd_rand random(server_options.seed);
-  auto generate_position = [&] {
-    Position position;
-    position.x = uint16_t(random() % server_options.size_x);
-    position.y = uint16_t(random() % server_options.size_y);
-    return position;
-  };
-  auto is_legal = [&](int x, int y) {
-    return x >= 0 && x < server_options.size_x && y >= 0 &&
-           y < server_options.size_y;
-  };
-
-  for (;;) {
-    // gathering players
-    std::map<PlayerId, socket_t> player_to_socket;
-    std::set<socket_t> playing_clients;
-    std::map<PlayerId, Player> players;
-    auto has_all_players = [&] {
-      if (int(playing_clients.size()) == int(server_options.players_count)) {
-        // sending GameStarted
-        RLock r_lock(catching_up_mutex);
-        Lock lock(clients_mutex);
-        game_started.players = players;
-        send_to_all_clients(game_started);
-        is_lobby = false;
-        return true;
-      }
-      return false;
-    };
-    has_all_players();
-    while (is_lobby) {
-      Lock lock(client_messages_mutex);
-      for (const auto &[client, client_message] : client_messages) {
-        if (playing_clients.contains(client))
-          continue;
-        if (!std::holds_alternative<Join>(client_message.m))
-          continue;
-
-        PlayerId player_id = PlayerId(playing_clients.size());
-        Player player;
-        player.name = get<Join>(client_message.m).name;
-        try {
-          player.address =
-              boost::lexical_cast<std::string>(client->remote_endpoint());
-        } catch (...) {
-          continue;
-        }
-        players[player_id] = player;
-        AcceptedPlayer accepted_player;
-        accepted_player.id = player_id;
-        accepted_player.player = player;
-        playing_clients.emplace(client);
-        player_to_socket[player_id] = client;
-        // sending AcceptedPlayer
-        {
-          RLock r_lock(catching_up_mutex);
-          Lock lock(clients_mutex);
-          send_to_all_clients(accepted_player);
-          accepted_players.emplace_back(accepted_player);
-        }
+  // the writes of io_uring to closed sockets cannot pass MSG_NOSIGNAL
+  if (!uring_loops.empty())
+    signal(SIGPIPE, SIG_IGN);
 
-        if (has_all_players())
-          break;
-      }
-      client_messages.clear();
+  std::unique_ptr<ReplayWriter> replay_writer;
+  if (!server_options.replay_dir.empty()) {
+    std::error_code error;
+    std::filesystem::create_directories(server_options.replay_dir, error);
+    if (error) {
+      std::cerr << "Could not create the replay directory" << std::endl;
+      exit(1);
     }
+    replay_writer = std::make_unique<ReplayWriter>(
+        server_options.replay_keyframe_interval);
+  }
 
-    std::map<PlayerId, Position> player_positions;
-    std::set<Position> blocks;
-    std::map<PlayerId, Score> scores;
-    std::map<BombId, Bomb> ticking_bombs;
-    BombId next_bomb_id = 0;
-
-    auto generate_turn_0 = [&] {
-      Turn turn_0;
-      turn_0.turn = 0;
-      for (PlayerId player_id = 0; player_id < server_options.players_count;
-           ++player_id) {
-        auto position = generate_position();
-        player_positions[player_id] = position;
-        scores[player_id] = 0;
-        PlayerMoved player_moved;
-        player_moved.id = player_id;
-        player_moved.position = position;
-        turn_0.events.emplace_back(player_moved);
-      }
-      for (uint16_t i = 0; i < server_options.initial_blocks; ++i) {
-        auto position = generate_position();
-        if (blocks.contains(position))
-          continue;
-        blocks.emplace(position);
-        turn_0.events.emplace_back(BlockPlaced{position});
-      }
-      return turn_0;
-    };
+  boost::asio::thread_pool workers(server_options.workers);
+  // idle rooms wait for clients without any pending work
+  auto workers_guard = boost::asio::make_work_guard(workers);
+  TurnPool turn_pool(server_options.turn_threads);
+  std::vector<std::unique_ptr<Room>> rooms;
+  for (uint16_t i = 0; i < server_options.rooms; ++i) {
+    rooms.emplace_back(std::make_unique<Room>(
+        workers, turn_pool, server_options, i, replay_writer.get()));
+    rooms.back()->start();
+  }
 
-    // turn 0
-    {
-      auto turn_0 = generate_turn_0();
-      RLock r_lock(catching_up_mutex);
-      Lock lock(clients_mutex);
-      send_to_all_clients(turn_0);
-      turns.emplace_back(turn_0);
+  auto idle_memory = resident_memory();
+  try {
+    for (auto &uring_loop : uring_loops)
+      accept(*uring_loop, reuse_port, rooms, server_options);
+  } catch (const std::system_error &) {
+    std::cerr << "Could not bind to the given port" << std::endl;
+    exit(1);
+  }
+  for (auto &acceptor : acceptors)
+    accept(acceptor->acceptor, io_context, rooms, server_options);
+  std::unique_ptr<MetricsServer> metrics_server;
+  if (server_options.metrics_port != 0) {
+    try {
+      metrics_server = std::make_unique<MetricsServer>(
+          io_context, server_options.metrics_port,
+          [&rooms](std::ostream &out) { write_gauges(out, rooms); });
+    } catch (...) {
+      std::cerr << "Could not bind to the metrics port" << std::endl;
+      exit(1);
     }
+  }
+  boost::asio::steady_timer stats_timer(io_context);
+  if (server_options.stats_interval > 0)
+    report_stats(stats_timer, server_options.stats_interval, idle_memory);
 
-    // turns 1..game_length
-    for (uint16_t turn_id = 0; turn_id < server_options.game_length;
-         ++turn_id) {
-      std::this_thread::sleep_for(
-          std::chrono::milliseconds(server_options.turn_duration));
-
-      Turn turn;
-      turn.turn = uint16_t(turn_id + 1);
-
-      std::set<PlayerId> exploded_players;
-      std::set<Position> exploded_blocks;
-      std::set<Position> blocks_to_be_placed;
-
-      // updating ticking bombs
-      for (auto it = ticking_bombs.begin(); it != ticking_bombs.end();) {
-        --it->second.timer;
-        if (it->second.timer == 0) {
-          BombExploded bomb_exploded;
-          bomb_exploded.id = it->first;
-          for (auto [dx, dy] : std::vector<std::pair<int, int>>{
-                   {1, 0}, {-1, 0}, {0, 1}, {0, -1}}) {
-            for (int i = 0; i <= server_options.explosion_radius; ++i) {
-              int x = it->second.position.x + i * dx;
-              int y = it->second.position.y + i * dy;
-              if (!is_legal(x, y))
-                break;
-              Position position = {uint16_t(x), uint16_t(y)};
-              for (const auto &[player_id, player_position] :
-                   player_positions) {
-                if (position == player_position) {
-                  bomb_exploded.robots_destroyed.emplace_back(player_id);
-                  exploded_players.emplace(player_id);
-                }
-              }
-              if (blocks.contains(position)) {
-                bomb_exploded.blocks_destroyed.emplace_back(position);
-                exploded_blocks.emplace(position);
-                break;
-              }
-            }
-          }
-          turn.events.emplace_back(bomb_exploded);
-          it = ticking_bombs.erase(it);
-        } else {
-          ++it;
-        }
-      }
-
-      // updating scores
-      for (const auto &player_id : exploded_players)
-        ++scores[player_id];
-
-      // player actions
-      {
-        Lock lock(client_messages_mutex);
-        for (PlayerId player_id = 0; player_id < server_options.players_count;
-             ++player_id) {
-          if (exploded_players.contains(player_id)) {
-            PlayerMoved player_moved;
-            player_moved.id = player_id;
-            player_moved.position = generate_position();
-            turn.events.emplace_back(player_moved);
-            player_positions[player_id] = player_moved.position;
-          } else {
-            auto it = client_messages.find(player_to_socket[player_id]);
-            if (it == client_messages.end()) {
-              continue;
-            }
-            auto client_message = it->second;
-            if (std::holds_alternative<PlaceBomb>(client_message.m)) {
-              auto bomb_id = next_bomb_id++;
-              auto position = player_positions[player_id];
-              ticking_bombs[bomb_id] = {position, server_options.bomb_timer};
-              turn.events.emplace_back(BombPlaced{bomb_id, position});
-            } else if (std::holds_alternative<PlaceBlock>(client_message.m)) {
-              auto position = player_positions[player_id];
-              if (!blocks.contains(position)) {
-                blocks_to_be_placed.emplace(position);
-                turn.events.emplace_back(BlockPlaced{position});
-              }
-            } else if (std::holds_alternative<Move>(client_message.m)) {
-              auto [x, y] = player_positions[player_id].move(
-                  std::get<Move>(client_message.m).direction);
-              if (is_legal(x, y)) {
-                Position new_position = {uint16_t(x), uint16_t(y)};
-                if (!blocks.contains(new_position)) {
-                  player_positions[player_id] = new_position;
-                  turn.events.emplace_back(
-                      PlayerMoved{player_id, new_position});
-                }
-              }
-            }
-          }
-        }
-        client_messages.clear();
-      }
+  boost::asio::signal_set trace_signals(io_context);
+  if (!server_options.trace_file.empty()) {
+#ifndef ROBOTS_TRACING
+    std::cerr << "The server was built without tracing" << std::endl;
+#endif
+    trace::enable();
+    trace_signals.add(SIGUSR1);
+    trace_signals.add(SIGINT);
+    trace_signals.add(SIGTERM);
+    handle_trace_signals(trace_signals, server_options.trace_file, [&] {
+      workers.stop();
+      io_context.stop();
+      for (auto &acceptor : acceptors)
+        acceptor->io_context.stop();
+    });
+  }
 
-      // block changes
-      for (const auto &block : exploded_blocks)
-        blocks.erase(block);
-      for (const auto &block : blocks_to_be_placed)
-        blocks.emplace(block);
+  std::vector<std::thread> io_threads;
+  for (uint16_t i = 0; i < server_options.io_threads; ++i)
+    io_threads.emplace_back([&] { io_context.run(); });
+  for (auto &acceptor : acceptors)
+    acceptor->thread = std::thread([&] { acceptor->io_context.run(); });
 
-      // sending Turn
-      {
-        RLock r_lock(catching_up_mutex);
-        Lock lock(clients_mutex);
-        send_to_all_clients(turn);
-        turns.emplace_back(turn);
-      }
-    }
-    // sending GameEnded
-    {
-      RLock r_lock(catching_up_mutex);
-      Lock lock(clients_mutex);
-      send_to_all_clients(GameEnded{scores});
-      accepted_players.clear();
-      turns.clear();
-      is_lobby = true;
-    }
-  }
+  workers.join();
+  for (auto &io_thread : io_threads)
+    io_thread.join();
+  for (auto &acceptor : acceptors)
+    acceptor->thread.join();
+  if (!server_options.trace_file.empty())
+    dump_trace(server_options.trace_file);
 }
@@ -0,0 +1,285 @@
+#include <chrono>
+#include <iostream>
+
+#include "room.hpp"
+#include "serialize.hpp"
+#include "trace.hpp"
+
+// the message is encoded straight into the buffer that is sent
+template <typename T> shared_message_t encode(const T &message) {
+  auto ret = std::make_shared<message_t>();
+  encode(*ret, message);
+  return ret;
+}
+
+void report_overrun(uint16_t turn, const TickReport &tick_report) {
+  using std::chrono::microseconds;
+  std::cerr << "Turn " << turn << " overran: started "
+            << std::chrono::duration_cast<microseconds>(tick_report.lateness)
+                   .count()
+            << " us late, took "
+            << std::chrono::duration_cast<microseconds>(tick_report.duration)
+                   .count()
+            << " us" << std::endl;
+}
+
+Room::Room(boost::asio::thread_pool &workers, TurnPool &turn_pool,
+           const ServerOptions &server_options_, uint16_t id_,
+           ReplayWriter *replay_writer_)
+    : server_options(server_options_), id(id_),
+      strand(boost::asio::make_strand(workers)), timer(strand),
+      replay_writer(replay_writer_), engine(server_options, &turn_pool),
+      game(server_options, server_options.seed + id),
+      tick_scheduler(std::chrono::milliseconds(server_options.turn_duration),
+                     server_options.overrun_policy) {
+  Hello hello_message;
+  hello_message.server_name = server_options.server_name;
+  hello_message.players_count = uint8_t(server_options.players_count);
+  hello_message.size_x = server_options.size_x;
+  hello_message.size_y = server_options.size_y;
+  hello_message.game_length = server_options.game_length;
+  hello_message.explosion_radius = server_options.explosion_radius;
+  hello_message.bomb_timer = server_options.bomb_timer;
+  hello = encode(hello_message);
+  game_ended = encode(GameEnded{});
+}
+
+void Room::start() {
+  boost::asio::post(strand, [this] { lobby(); });
+}
+
+void Room::join(session_t session) {
+  boost::asio::post(strand, [this, session = std::move(session)] {
+    TRACE_SPAN("catch_up");
+    // sending previous server messages
+    session->catch_up(previous_messages());
+    Lock lock(clients_mutex);
+    clients.emplace(session);
+  });
+}
+
+void Room::join_game(const session_t &session, std::string name) {
+  if (!is_lobby)
+    return;
+  boost::asio::post(strand, [this, session, name = std::move(name)] {
+    if (is_lobby)
+      accept_player(session, name);
+  });
+}
+
+void Room::leave(const session_t &session) {
+  // after the room is done with joining the session
+  boost::asio::post(strand, [this, session] {
+    Lock lock(clients_mutex);
+    clients.erase(session);
+  });
+}
+
+void Room::resync(const session_t &session) {
+  boost::asio::post(strand, [this, session] {
+    TRACE_SPAN("resync");
+    auto messages = previous_messages();
+    // the client may have missed the end of the game it was watching, and
+    // GameEnded is the only message on which it clears its state
+    messages.insert(messages.begin(), game_ended);
+    session->catch_up(std::move(messages));
+  });
+}
+
+bool Room::is_open() {
+  Lock lock(clients_mutex);
+  return is_lobby && clients.size() < server_options.players_count;
+}
+
+size_t Room::clients_count() {
+  Lock lock(clients_mutex);
+  return clients.size();
+}
+
+void Room::send_to_all_clients(const shared_message_t &message) {
+  TRACE_SPAN("send_to_all");
+  for (const auto &client : clients) {
+    client->send(message);
+  }
+}
+
+void Room::record(const shared_message_t &message) {
+  if (replay)
+    replay_writer->append(replay, message);
+}
+
+std::vector<shared_message_t> Room::previous_messages() {
+  std::vector<shared_message_t> ret{hello};
+  if (is_lobby) {
+    ret.insert(ret.end(), accepted_players.begin(), accepted_players.end());
+  } else {
+    ret.emplace_back(game_started);
+    if (server_options.catch_up_mode == CatchUpMode::Snapshot) {
+      // the snapshot only places blocks, so it is sent to a client with no
+      // state, which resync makes sure of with GameEnded
+      if (snapshot.empty())
+        make_snapshot();
+      ret.insert(ret.end(), snapshot.begin(), snapshot.end());
+    } else {
+      ret.insert(ret.end(), turns.begin(), turns.end());
+    }
+  }
+  return ret;
+}
+
+void Room::make_snapshot() {
+  for (const auto &turn : engine.snapshot(game))
+    snapshot.emplace_back(encode(turn));
+}
+
+// gathering players, runs whenever a client may have joined
+void Room::lobby() {
+  if (has_all_players())
+    start_game();
+}
+
+void Room::accept_player(const session_t &session, const std::string &name) {
+  if (playing_clients.contains(session))
+    return;
+
+  PlayerId player_id = PlayerId(playing_clients.size());
+  Player player;
+  player.name = name;
+  player.address = session->address();
+  players[player_id] = player;
+  AcceptedPlayer accepted_player;
+  accepted_player.id = player_id;
+  accepted_player.player = player;
+  playing_clients.emplace(session);
+  player_to_session[player_id] = session;
+  accepted_players_count = playing_clients.size();
+  // sending AcceptedPlayer
+  {
+    auto message = encode(accepted_player);
+    Lock lock(clients_mutex);
+    send_to_all_clients(message);
+    accepted_players.emplace_back(message);
+  }
+  lobby();
+}
+
+bool Room::has_all_players() {
+  if (int(playing_clients.size()) == int(server_options.players_count)) {
+    // sending GameStarted
+    Lock lock(clients_mutex);
+    game_started = encode(GameStarted{players});
+    send_to_all_clients(game_started);
+    is_lobby = false;
+    if (replay_writer) {
+      auto now = std::chrono::system_clock::now().time_since_epoch();
+      replay = replay_writer->open(
+          server_options.replay_dir + "/room" + std::to_string(id) + "-" +
+          std::to_string(
+              std::chrono::duration_cast<std::chrono::milliseconds>(now)
+                  .count()) +
+          ".replay");
+      record(hello);
+      record(game_started);
+    }
+    return true;
+  }
+  return false;
+}
+
+void Room::start_game() {
+  // actions sent before the game started are dropped
+  for (const auto &[player_id, session] : player_to_session)
+    session->take_input();
+
+  // turn 0
+  {
+    auto message = encode(engine.start(game));
+    record(message);
+    Lock lock(clients_mutex);
+    send_to_all_clients(message);
+    if (server_options.catch_up_mode == CatchUpMode::Replay)
+      turns.emplace_back(message);
+  }
+
+  // turns 1..game_length
+  tick_scheduler.start();
+  schedule_turn();
+}
+
+void Room::schedule_turn() {
+  if (engine.is_over(game)) {
+    end_game();
+    return;
+  }
+  timer.expires_at(tick_scheduler.deadline());
+  timer.async_wait([this](const boost::system::error_code &) {
+    tick_scheduler.begin();
+    TRACE_SPAN("turn");
+    auto start = metrics::clock::now();
+    auto turn = play_turn();
+    snapshot.clear();
+    current_turn = turn.turn;
+    auto played = metrics::clock::now();
+    metrics::observe(metrics::Histogram::TurnDuration, played - start);
+
+    // sending Turn
+    {
+      shared_message_t message;
+      {
+        TRACE_SPAN("encode");
+        message = encode(turn);
+      }
+      record(message);
+      Lock lock(clients_mutex);
+      send_to_all_clients(message);
+      if (server_options.catch_up_mode == CatchUpMode::Replay)
+        turns.emplace_back(message);
+    }
+    metrics::observe(metrics::Histogram::BroadcastDuration,
+                     metrics::clock::now() - played);
+    metrics::add(metrics::Counter::TurnsPlayed);
+
+    auto tick_report = tick_scheduler.finish();
+    if (tick_report.overrun) {
+      metrics::add(metrics::Counter::TurnOverruns);
+      report_overrun(turn.turn, tick_report);
+    }
+    schedule_turn();
+  });
+}
+
+Turn Room::play_turn() {
+  Inputs inputs(server_options.players_count);
+  {
+    TRACE_SPAN("take_inputs");
+    for (const auto &[player_id, session] : player_to_session)
+      inputs[player_id] = session->take_input();
+  }
+  return engine.step(game, inputs);
+}
+
+void Room::end_game() {
+  // sending GameEnded
+  {
+    Lock lock(clients_mutex);
+    game_ended = encode(GameEnded{game.scores});
+    send_to_all_clients(game_ended);
+  }
+  if (replay) {
+    record(game_ended);
+    replay_writer->close(replay);
+    replay.reset();
+  }
+  accepted_players.clear();
+  turns.clear();
+  snapshot.clear();
+  is_lobby = true;
+  accepted_players_count = 0;
+  current_turn = 0;
+
+  player_to_session.clear();
+  playing_clients.clear();
+  players.clear();
+  game.clear();
+  lobby();
+}
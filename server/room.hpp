@@ -0,0 +1,119 @@
+#ifndef __ROOM_HPP
+#define __ROOM_HPP
+
+// boost/asio/awaitable.hpp uses std::exchange without including <utility>
+#include <utility>
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <memory>
+#include <mutex>
+#include <set>
+
+#include "game_engine.hpp"
+#include "messages.hpp"
+#include "metrics.hpp"
+#include "replay_writer.hpp"
+#include "server_options.hpp"
+#include "session.hpp"
+#include "tick_scheduler.hpp"
+
+using session_t = std::shared_ptr<Session>;
+
+// A single game hosted by the server together with the clients connected to
+// it. The lobby and the turns of a room run as short steps on its strand, so
+// that many rooms can share a fixed pool of worker threads. Clients join,
+// leave and catch up on the same strand, so they always see the room between
+// two steps.
+class Room {
+public:
+  // records the games if replay_writer_ is not null, the turns are played
+  // with the help of turn_pool
+  Room(boost::asio::thread_pool &workers, TurnPool &turn_pool,
+       const ServerOptions &server_options_, uint16_t id_,
+       ReplayWriter *replay_writer_);
+
+  // starts gathering players
+  void start();
+
+  // relays previous server messages to a new client and starts sending it
+  // new ones
+  void join(session_t session);
+
+  // passes a Join of a client to the lobby
+  void join_game(const session_t &session, std::string name);
+
+  void leave(const session_t &session);
+
+  // relays previous server messages to a client again, after its queue of
+  // outgoing messages was dropped
+  void resync(const session_t &session);
+
+  // whether the room is waiting for more players than it has clients
+  bool is_open();
+
+  size_t clients_count();
+
+  // gauges, can be read from any thread
+  size_t players_count() const { return accepted_players_count; }
+  uint16_t turn() const { return current_turn; }
+  bool in_lobby() const { return is_lobby; }
+
+private:
+  using Lock = metrics::TimedLock<std::mutex>;
+
+  const ServerOptions &server_options;
+  const uint16_t id;
+  boost::asio::strand<boost::asio::thread_pool::executor_type> strand;
+  boost::asio::steady_timer timer;
+
+  std::set<session_t> clients;
+  std::mutex clients_mutex;
+
+  // previous server messages, encoded once for all clients
+  shared_message_t hello;
+  std::vector<shared_message_t> accepted_players;
+  shared_message_t game_started;
+  // only kept when catching up by replay
+  std::vector<shared_message_t> turns;
+  shared_message_t game_ended;
+  // synthetic turns rebuilding the current state, built for the first client
+  // that catches up after a turn
+  std::vector<shared_message_t> snapshot;
+
+  ReplayWriter *replay_writer;
+  // the replay of the current game, if it is recorded
+  ReplayWriter::file_t replay;
+
+  std::atomic<bool> is_lobby = true;
+  std::atomic<size_t> accepted_players_count = 0;
+  std::atomic<uint16_t> current_turn = 0;
+
+  // lobby state
+  std::map<PlayerId, session_t> player_to_session;
+  std::set<session_t> playing_clients;
+  std::map<PlayerId, Player> players;
+
+  // game state
+  GameEngine engine;
+  GameState game;
+  TickScheduler tick_scheduler;
+
+  // assumes that the caller acquired the clients_mutex
+  void send_to_all_clients(const shared_message_t &message);
+
+  void record(const shared_message_t &message);
+
+  std::vector<shared_message_t> previous_messages();
+  void make_snapshot();
+
+  void lobby();
+  void accept_player(const session_t &session, const std::string &name);
+  bool has_all_players();
+  void start_game();
+  void schedule_turn();
+  Turn play_turn();
+  void end_game();
+};
+
+#endif // __ROOM_HPP
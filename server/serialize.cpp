@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "serialize.hpp"
 
 template <typename T> void append(std::vector<T> &x, const std::vector<T> &y) {
@@ -16,8 +18,9 @@ template <std::integral T> message_t serialize(T x) {
 }
 
 message_t serialize(const std::string &x) {
-  message_t ret{uint8_t(x.length())};
-  ret.insert(ret.end(), x.begin(), x.end());
+  message_t ret(x.length() + 1);
+  ret[0] = uint8_t(x.length());
+  std::copy(x.begin(), x.end(), ret.begin() + 1);
   return ret;
 }
 
@@ -210,3 +213,312 @@ message_t serialize(const ServerMessage &x) {
   else
     return serialize(std::get<GameEnded>(x.m));
 }
+
+template <std::integral T> size_t encoded_size(T) { return sizeof(T); }
+
+size_t encoded_size(const std::string &x) { return x.length() + 1; }
+
+template <typename T> size_t encoded_size(const std::vector<T> &x) {
+  size_t ret = sizeof(uint32_t);
+  for (const auto &v : x)
+    ret += encoded_size(v);
+  return ret;
+}
+
+template <typename K, typename V> size_t encoded_size(const std::map<K, V> &x) {
+  size_t ret = sizeof(uint32_t);
+  for (const auto &[k, v] : x)
+    ret += encoded_size(k) + encoded_size(v);
+  return ret;
+}
+
+size_t encoded_size(const Position &) { return 2 * sizeof(uint16_t); }
+
+size_t encoded_size(const Bomb &) { return 3 * sizeof(uint16_t); }
+
+size_t encoded_size(const Player &x) {
+  return encoded_size(x.name) + encoded_size(x.address);
+}
+
+size_t encoded_size(const Lobby &x) {
+  return 1 + encoded_size(x.server_name) + sizeof(uint8_t) +
+         5 * sizeof(uint16_t) + encoded_size(x.players);
+}
+
+size_t encoded_size(const Game &x) {
+  return 1 + encoded_size(x.server_name) + 4 * sizeof(uint16_t) +
+         encoded_size(x.players) + encoded_size(x.player_positions) +
+         encoded_size(x.blocks) + encoded_size(x.bombs) +
+         encoded_size(x.explosions) + encoded_size(x.scores);
+}
+
+size_t encoded_size(const DrawMessage &x) {
+  if (std::holds_alternative<Lobby>(x.m))
+    return encoded_size(std::get<Lobby>(x.m));
+  else
+    return encoded_size(std::get<Game>(x.m));
+}
+
+size_t encoded_size(const Direction &) { return sizeof(uint8_t); }
+
+size_t encoded_size(const Join &x) { return 1 + encoded_size(x.name); }
+
+size_t encoded_size([[maybe_unused]] const PlaceBomb &x) { return 1; }
+
+size_t encoded_size([[maybe_unused]] const PlaceBlock &x) { return 1; }
+
+size_t encoded_size(const Move &x) { return 1 + encoded_size(x.direction); }
+
+size_t encoded_size(const ClientMessage &x) {
+  if (std::holds_alternative<Join>(x.m))
+    return encoded_size(std::get<Join>(x.m));
+  else if (std::holds_alternative<PlaceBomb>(x.m))
+    return encoded_size(std::get<PlaceBomb>(x.m));
+  else if (std::holds_alternative<PlaceBlock>(x.m))
+    return encoded_size(std::get<PlaceBlock>(x.m));
+  else
+    return encoded_size(std::get<Move>(x.m));
+}
+
+size_t encoded_size(const BombPlaced &x) {
+  return 1 + encoded_size(x.id) + encoded_size(x.position);
+}
+
+size_t encoded_size(const BombExploded &x) {
+  return 1 + encoded_size(x.id) + encoded_size(x.robots_destroyed) +
+         encoded_size(x.blocks_destroyed);
+}
+
+size_t encoded_size(const PlayerMoved &x) {
+  return 1 + encoded_size(x.id) + encoded_size(x.position);
+}
+
+size_t encoded_size(const BlockPlaced &x) {
+  return 1 + encoded_size(x.position);
+}
+
+size_t encoded_size(const Event &x) {
+  if (std::holds_alternative<BombPlaced>(x.m))
+    return encoded_size(std::get<BombPlaced>(x.m));
+  else if (std::holds_alternative<BombExploded>(x.m))
+    return encoded_size(std::get<BombExploded>(x.m));
+  else if (std::holds_alternative<PlayerMoved>(x.m))
+    return encoded_size(std::get<PlayerMoved>(x.m));
+  else
+    return encoded_size(std::get<BlockPlaced>(x.m));
+}
+
+size_t encoded_size(const Hello &x) {
+  return 1 + encoded_size(x.server_name) + sizeof(uint8_t) +
+         5 * sizeof(uint16_t);
+}
+
+size_t encoded_size(const AcceptedPlayer &x) {
+  return 1 + encoded_size(x.id) + encoded_size(x.player);
+}
+
+size_t encoded_size(const GameStarted &x) {
+  return 1 + encoded_size(x.players);
+}
+
+size_t encoded_size(const Turn &x) {
+  return 1 + encoded_size(x.turn) + encoded_size(x.events);
+}
+
+size_t encoded_size(const GameEnded &x) { return 1 + encoded_size(x.scores); }
+
+size_t encoded_size(const ServerMessage &x) {
+  if (std::holds_alternative<Hello>(x.m))
+    return encoded_size(std::get<Hello>(x.m));
+  else if (std::holds_alternative<AcceptedPlayer>(x.m))
+    return encoded_size(std::get<AcceptedPlayer>(x.m));
+  else if (std::holds_alternative<GameStarted>(x.m))
+    return encoded_size(std::get<GameStarted>(x.m));
+  else if (std::holds_alternative<Turn>(x.m))
+    return encoded_size(std::get<Turn>(x.m));
+  else
+    return encoded_size(std::get<GameEnded>(x.m));
+}
+
+template <std::integral T> void encode(Writer &writer, T x) { writer.put(x); }
+
+void encode(Writer &writer, const std::string &x) {
+  writer.put(uint8_t(x.length()));
+  writer.put(x.data(), x.length());
+}
+
+template <typename T> void encode(Writer &writer, const std::vector<T> &x) {
+  writer.put(uint32_t(x.size()));
+  for (const auto &v : x)
+    encode(writer, v);
+}
+
+template <typename K, typename V>
+void encode(Writer &writer, const std::map<K, V> &x) {
+  writer.put(uint32_t(x.size()));
+  for (const auto &[k, v] : x) {
+    encode(writer, k);
+    encode(writer, v);
+  }
+}
+
+void encode(Writer &writer, const Position &x) {
+  writer.put(x.x);
+  writer.put(x.y);
+}
+
+void encode(Writer &writer, const Bomb &x) {
+  encode(writer, x.position);
+  writer.put(x.timer);
+}
+
+void encode(Writer &writer, const Player &x) {
+  encode(writer, x.name);
+  encode(writer, x.address);
+}
+
+void encode(Writer &writer, const Lobby &x) {
+  writer.put(uint8_t(0));
+  encode(writer, x.server_name);
+  writer.put(x.players_count);
+  writer.put(x.size_x);
+  writer.put(x.size_y);
+  writer.put(x.game_length);
+  writer.put(x.explosion_radius);
+  writer.put(x.bomb_timer);
+  encode(writer, x.players);
+}
+
+void encode(Writer &writer, const Game &x) {
+  writer.put(uint8_t(1));
+  encode(writer, x.server_name);
+  writer.put(x.size_x);
+  writer.put(x.size_y);
+  writer.put(x.game_length);
+  writer.put(x.turn);
+  encode(writer, x.players);
+  encode(writer, x.player_positions);
+  encode(writer, x.blocks);
+  encode(writer, x.bombs);
+  encode(writer, x.explosions);
+  encode(writer, x.scores);
+}
+
+void encode(Writer &writer, const DrawMessage &x) {
+  if (std::holds_alternative<Lobby>(x.m))
+    encode(writer, std::get<Lobby>(x.m));
+  else
+    encode(writer, std::get<Game>(x.m));
+}
+
+void encode(Writer &writer, const Direction &x) { writer.put(uint8_t(x)); }
+
+void encode(Writer &writer, const Join &x) {
+  writer.put(uint8_t(0));
+  encode(writer, x.name);
+}
+
+void encode(Writer &writer, [[maybe_unused]] const PlaceBomb &x) {
+  writer.put(uint8_t(1));
+}
+
+void encode(Writer &writer, [[maybe_unused]] const PlaceBlock &x) {
+  writer.put(uint8_t(2));
+}
+
+void encode(Writer &writer, const Move &x) {
+  writer.put(uint8_t(3));
+  encode(writer, x.direction);
+}
+
+void encode(Writer &writer, const ClientMessage &x) {
+  if (std::holds_alternative<Join>(x.m))
+    encode(writer, std::get<Join>(x.m));
+  else if (std::holds_alternative<PlaceBomb>(x.m))
+    encode(writer, std::get<PlaceBomb>(x.m));
+  else if (std::holds_alternative<PlaceBlock>(x.m))
+    encode(writer, std::get<PlaceBlock>(x.m));
+  else
+    encode(writer, std::get<Move>(x.m));
+}
+
+void encode(Writer &writer, const BombPlaced &x) {
+  writer.put(uint8_t(0));
+  writer.put(x.id);
+  encode(writer, x.position);
+}
+
+void encode(Writer &writer, const BombExploded &x) {
+  writer.put(uint8_t(1));
+  writer.put(x.id);
+  encode(writer, x.robots_destroyed);
+  encode(writer, x.blocks_destroyed);
+}
+
+void encode(Writer &writer, const PlayerMoved &x) {
+  writer.put(uint8_t(2));
+  writer.put(x.id);
+  encode(writer, x.position);
+}
+
+void encode(Writer &writer, const BlockPlaced &x) {
+  writer.put(uint8_t(3));
+  encode(writer, x.position);
+}
+
+void encode(Writer &writer, const Event &x) {
+  if (std::holds_alternative<BombPlaced>(x.m))
+    encode(writer, std::get<BombPlaced>(x.m));
+  else if (std::holds_alternative<BombExploded>(x.m))
+    encode(writer, std::get<BombExploded>(x.m));
+  else if (std::holds_alternative<PlayerMoved>(x.m))
+    encode(writer, std::get<PlayerMoved>(x.m));
+  else
+    encode(writer, std::get<BlockPlaced>(x.m));
+}
+
+void encode(Writer &writer, const Hello &x) {
+  writer.put(uint8_t(0));
+  encode(writer, x.server_name);
+  writer.put(x.players_count);
+  writer.put(x.size_x);
+  writer.put(x.size_y);
+  writer.put(x.game_length);
+  writer.put(x.explosion_radius);
+  writer.put(x.bomb_timer);
+}
+
+void encode(Writer &writer, const AcceptedPlayer &x) {
+  writer.put(uint8_t(1));
+  writer.put(x.id);
+  encode(writer, x.player);
+}
+
+void encode(Writer &writer, const GameStarted &x) {
+  writer.put(uint8_t(2));
+  encode(writer, x.players);
+}
+
+void encode(Writer &writer, const Turn &x) {
+  writer.put(uint8_t(3));
+  writer.put(x.turn);
+  encode(writer, x.events);
+}
+
+void encode(Writer &writer, const GameEnded &x) {
+  writer.put(uint8_t(4));
+  encode(writer, x.scores);
+}
+
+void encode(Writer &writer, const ServerMessage &x) {
+  if (std::holds_alternative<Hello>(x.m))
+    encode(writer, std::get<Hello>(x.m));
+  else if (std::holds_alternative<AcceptedPlayer>(x.m))
+    encode(writer, std::get<AcceptedPlayer>(x.m));
+  else if (std::holds_alternative<GameStarted>(x.m))
+    encode(writer, std::get<GameStarted>(x.m));
+  else if (std::holds_alternative<Turn>(x.m))
+    encode(writer, std::get<Turn>(x.m));
+  else
+    encode(writer, std::get<GameEnded>(x.m));
+}
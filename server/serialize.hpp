@@ -1,6 +1,8 @@
 #ifndef __SERIALIZE_HPP
 #define __SERIALIZE_HPP
 
+#include <cstring>
+
 #include "messages.hpp"
 
 template <std::integral T> message_t serialize(T x);
@@ -57,4 +59,147 @@ message_t serialize(const GameEnded &x);
 
 message_t serialize(const ServerMessage &x);
 
+// Writes big-endian fields to a buffer that is large enough for them.
+class Writer {
+public:
+  explicit Writer(uint8_t *data_) : data(data_), pos(data_) {}
+
+  template <std::integral T> void put(T x) {
+    for (size_t i = sizeof(T); i-- > 0;)
+      *pos++ = uint8_t(x >> (8 * i));
+  }
+
+  void put(const void *bytes, size_t size) {
+    std::memcpy(pos, bytes, size);
+    pos += size;
+  }
+
+  // number of bytes written so far
+  size_t position() const { return size_t(pos - data); }
+
+private:
+  uint8_t *data;
+  uint8_t *pos;
+};
+
+// The streaming counterparts of serialize: encoded_size(x) is the exact
+// number of bytes that encode(writer, x) writes, so that a message is encoded
+// into a single buffer without intermediate allocations.
+template <std::integral T> size_t encoded_size(T x);
+
+size_t encoded_size(const std::string &x);
+
+template <typename T> size_t encoded_size(const std::vector<T> &x);
+
+template <typename K, typename V> size_t encoded_size(const std::map<K, V> &x);
+
+size_t encoded_size(const Position &x);
+
+size_t encoded_size(const Bomb &x);
+
+size_t encoded_size(const Player &x);
+
+size_t encoded_size(const Lobby &x);
+
+size_t encoded_size(const Game &x);
+
+size_t encoded_size(const DrawMessage &x);
+
+size_t encoded_size(const Direction &x);
+
+size_t encoded_size(const Join &x);
+
+size_t encoded_size(const PlaceBomb &x);
+
+size_t encoded_size(const PlaceBlock &x);
+
+size_t encoded_size(const Move &x);
+
+size_t encoded_size(const ClientMessage &x);
+
+size_t encoded_size(const BombPlaced &x);
+
+size_t encoded_size(const BombExploded &x);
+
+size_t encoded_size(const PlayerMoved &x);
+
+size_t encoded_size(const BlockPlaced &x);
+
+size_t encoded_size(const Event &x);
+
+size_t encoded_size(const Hello &x);
+
+size_t encoded_size(const AcceptedPlayer &x);
+
+size_t encoded_size(const GameStarted &x);
+
+size_t encoded_size(const Turn &x);
+
+size_t encoded_size(const GameEnded &x);
+
+size_t encoded_size(const ServerMessage &x);
+
+template <std::integral T> void encode(Writer &writer, T x);
+
+void encode(Writer &writer, const std::string &x);
+
+template <typename T> void encode(Writer &writer, const std::vector<T> &x);
+
+template <typename K, typename V>
+void encode(Writer &writer, const std::map<K, V> &x);
+
+void encode(Writer &writer, const Position &x);
+
+void encode(Writer &writer, const Bomb &x);
+
+void encode(Writer &writer, const Player &x);
+
+void encode(Writer &writer, const Lobby &x);
+
+void encode(Writer &writer, const Game &x);
+
+void encode(Writer &writer, const DrawMessage &x);
+
+void encode(Writer &writer, const Direction &x);
+
+void encode(Writer &writer, const Join &x);
+
+void encode(Writer &writer, const PlaceBomb &x);
+
+void encode(Writer &writer, const PlaceBlock &x);
+
+void encode(Writer &writer, const Move &x);
+
+void encode(Writer &writer, const ClientMessage &x);
+
+void encode(Writer &writer, const BombPlaced &x);
+
+void encode(Writer &writer, const BombExploded &x);
+
+void encode(Writer &writer, const PlayerMoved &x);
+
+void encode(Writer &writer, const BlockPlaced &x);
+
+void encode(Writer &writer, const Event &x);
+
+void encode(Writer &writer, const Hello &x);
+
+void encode(Writer &writer, const AcceptedPlayer &x);
+
+void encode(Writer &writer, const GameStarted &x);
+
+void encode(Writer &writer, const Turn &x);
+
+void encode(Writer &writer, const GameEnded &x);
+
+void encode(Writer &writer, const ServerMessage &x);
+
+// replaces the contents of the message with the encoding of x, reusing its
+// memory
+template <typename T> void encode(message_t &message, const T &x) {
+  message.resize(encoded_size(x));
+  Writer writer(message.data());
+  encode(writer, x);
+}
+
 #endif // __SERIALIZE_HPP
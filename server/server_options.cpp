@@ -1,9 +1,27 @@
 #include <boost/program_options.hpp>
 #include <chrono>
 #include <iostream>
+#include <stdexcept>
+#include <thread>
 
 #include "server_options.hpp"
 
+CatchUpMode parse_catch_up_mode(const std::string &s) {
+  if (s == "replay")
+    return CatchUpMode::Replay;
+  if (s == "snapshot")
+    return CatchUpMode::Snapshot;
+  throw std::invalid_argument(s);
+}
+
+TransportType parse_transport_type(const std::string &s) {
+  if (s == "asio")
+    return TransportType::Asio;
+  if (s == "uring")
+    return TransportType::Uring;
+  throw std::invalid_argument(s);
+}
+
 ServerOptions get_server_options(int argc, char *argv[]) {
   namespace po = boost::program_options;
   try {
@@ -18,7 +36,34 @@ ServerOptions get_server_options(int argc, char *argv[]) {
                           "<String>")("port,p", po::value<uint16_t>(), "<u16>")(
         "seed,s", po::value<uint32_t>(), "<u32, optional parameter>")(
         "size-x,x", po::value<uint16_t>(),
-        "<u16>")("size-y,y", po::value<uint16_t>(), "<u16>");
+        "<u16>")("size-y,y", po::value<uint16_t>(), "<u16>")(
+        "overrun-policy", po::value<std::string>(),
+        "<catch-up|skip|stretch, optional parameter>")(
+        "rooms", po::value<uint16_t>(), "<u16, optional parameter>")(
+        "workers", po::value<uint16_t>(), "<u16, optional parameter>")(
+        "turn-threads", po::value<uint16_t>(), "<u16, optional parameter>")(
+        "io-threads", po::value<uint16_t>(), "<u16, optional parameter>")(
+        "acceptors", po::value<uint16_t>(), "<u16, optional parameter>")(
+        "transport", po::value<std::string>(),
+        "<asio|uring, optional parameter>")(
+        "stats-interval", po::value<uint16_t>(),
+        "<u16, seconds, optional parameter>")(
+        "max-queued-bytes", po::value<uint64_t>(),
+        "<u64, optional parameter>")("max-queued-messages",
+                                     po::value<uint32_t>(),
+                                     "<u32, optional parameter>")(
+        "max-write-batch-bytes", po::value<uint64_t>(),
+        "<u64, optional parameter>")(
+        "slow-consumer-policy", po::value<std::string>(),
+        "<drop|resync, optional parameter>")(
+        "catch-up", po::value<std::string>(),
+        "<replay|snapshot, optional parameter>")(
+        "replay-dir", po::value<std::string>(),
+        "<path, optional parameter>")(
+        "replay-keyframe-interval", po::value<uint16_t>(),
+        "<u16, turns, optional parameter>")(
+        "metrics-port", po::value<uint16_t>(), "<u16, optional parameter>")(
+        "trace-file", po::value<std::string>(), "<path, optional parameter>");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -54,6 +99,39 @@ ServerOptions get_server_options(int argc, char *argv[]) {
     check_option("seed", ret.seed, false);
     check_option("size-x", ret.size_x);
     check_option("size-y", ret.size_y);
+    std::string overrun_policy = "catch-up";
+    check_option("overrun-policy", overrun_policy, false);
+    ret.rooms = 1;
+    check_option("rooms", ret.rooms, false);
+    ret.workers = uint16_t(std::max(1u, std::thread::hardware_concurrency()));
+    check_option("workers", ret.workers, false);
+    ret.turn_threads = 1;
+    check_option("turn-threads", ret.turn_threads, false);
+    ret.io_threads = 1;
+    check_option("io-threads", ret.io_threads, false);
+    ret.acceptors = 1;
+    check_option("acceptors", ret.acceptors, false);
+    std::string transport = "asio";
+    check_option("transport", transport, false);
+    ret.stats_interval = 0;
+    check_option("stats-interval", ret.stats_interval, false);
+    ret.max_queued_bytes = 64 << 20;
+    check_option("max-queued-bytes", ret.max_queued_bytes, false);
+    ret.max_queued_messages = 1 << 17;
+    check_option("max-queued-messages", ret.max_queued_messages, false);
+    ret.max_write_batch_bytes = 64 << 10;
+    check_option("max-write-batch-bytes", ret.max_write_batch_bytes, false);
+    std::string slow_consumer_policy = "drop";
+    check_option("slow-consumer-policy", slow_consumer_policy, false);
+    std::string catch_up_mode = "replay";
+    check_option("catch-up", catch_up_mode, false);
+    check_option("replay-dir", ret.replay_dir, false);
+    ret.replay_keyframe_interval = 100;
+    check_option("replay-keyframe-interval", ret.replay_keyframe_interval,
+                 false);
+    ret.metrics_port = 0;
+    check_option("metrics-port", ret.metrics_port, false);
+    check_option("trace-file", ret.trace_file, false);
 
     constexpr int players_count_limit = (1 << 8);
     if (vm.count("players-count") && ret.players_count >= players_count_limit) {
@@ -62,6 +140,63 @@ ServerOptions get_server_options(int argc, char *argv[]) {
                                "') for option '--players-count' is invalid");
     }
 
+    try {
+      ret.overrun_policy = parse_overrun_policy(overrun_policy);
+    } catch (const std::invalid_argument &) {
+      throw std::runtime_error("the argument ('" + overrun_policy +
+                               "') for option '--overrun-policy' is invalid");
+    }
+
+    try {
+      ret.slow_consumer_policy =
+          parse_slow_consumer_policy(slow_consumer_policy);
+    } catch (const std::invalid_argument &) {
+      throw std::runtime_error(
+          "the argument ('" + slow_consumer_policy +
+          "') for option '--slow-consumer-policy' is invalid");
+    }
+
+    try {
+      ret.catch_up_mode = parse_catch_up_mode(catch_up_mode);
+    } catch (const std::invalid_argument &) {
+      throw std::runtime_error("the argument ('" + catch_up_mode +
+                               "') for option '--catch-up' is invalid");
+    }
+    try {
+      ret.transport = parse_transport_type(transport);
+    } catch (const std::invalid_argument &) {
+      throw std::runtime_error("the argument ('" + transport +
+                               "') for option '--transport' is invalid");
+    }
+    if (ret.rooms == 0) {
+      throw std::runtime_error("the argument ('0') for option '--rooms' is "
+                               "invalid");
+    }
+    if (ret.replay_keyframe_interval == 0) {
+      throw std::runtime_error("the argument ('0') for option "
+                               "'--replay-keyframe-interval' is invalid");
+    }
+    if (ret.workers == 0) {
+      throw std::runtime_error("the argument ('0') for option '--workers' is "
+                               "invalid");
+    }
+    if (ret.max_write_batch_bytes == 0) {
+      throw std::runtime_error("the argument ('0') for option "
+                               "'--max-write-batch-bytes' is invalid");
+    }
+    if (ret.turn_threads == 0) {
+      throw std::runtime_error("the argument ('0') for option '--turn-threads' "
+                               "is invalid");
+    }
+    if (ret.io_threads == 0) {
+      throw std::runtime_error("the argument ('0') for option '--io-threads' "
+                               "is invalid");
+    }
+    if (ret.acceptors == 0) {
+      throw std::runtime_error("the argument ('0') for option '--acceptors' "
+                               "is invalid");
+    }
+
     if (missing_options.empty()) {
       return ret;
     } else {
@@ -3,6 +3,29 @@
 
 #include <string>
 
+#include "session.hpp"
+#include "tick_scheduler.hpp"
+
+// How a client that connects in the middle of a game is brought up to date.
+enum class CatchUpMode {
+  // relay every turn played so far
+  Replay,
+  // relay a few synthetic turns that rebuild the current state of the game
+  Snapshot,
+};
+
+CatchUpMode parse_catch_up_mode(const std::string &s);
+
+// How the connections of the clients are handled.
+enum class TransportType {
+  // the reactor of asio
+  Asio,
+  // an io_uring, if the kernel supports it
+  Uring,
+};
+
+TransportType parse_transport_type(const std::string &s);
+
 struct ServerOptions {
   uint16_t bomb_timer;
   uint16_t players_count;
@@ -15,6 +38,29 @@ struct ServerOptions {
   uint32_t seed;
   uint16_t size_x;
   uint16_t size_y;
+  OverrunPolicy overrun_policy;
+  uint16_t rooms;
+  uint16_t workers;
+  // threads playing a turn, the worker thread included
+  uint16_t turn_threads;
+  uint16_t io_threads;
+  // listening sockets sharing the port, each one with a thread of its own
+  uint16_t acceptors;
+  TransportType transport;
+  uint16_t stats_interval;
+  uint64_t max_queued_bytes;
+  uint32_t max_queued_messages;
+  // a single write sends queued messages up to this many bytes together
+  uint64_t max_write_batch_bytes;
+  SlowConsumerPolicy slow_consumer_policy;
+  CatchUpMode catch_up_mode;
+  // the games are recorded to this directory, if not empty
+  std::string replay_dir;
+  uint16_t replay_keyframe_interval;
+  // the metrics are served on this port of the loopback interface, if not 0
+  uint16_t metrics_port;
+  // the trace is recorded and dumped to this file, if not empty
+  std::string trace_file;
 };
 
 ServerOptions get_server_options(int argc, char *argv[]);
@@ -0,0 +1,231 @@
+#include "deserialize.hpp"
+#include "metrics.hpp"
+#include "room.hpp"
+#include "server_options.hpp"
+#include "session.hpp"
+
+SlowConsumerPolicy parse_slow_consumer_policy(const std::string &s) {
+  if (s == "drop")
+    return SlowConsumerPolicy::Drop;
+  else if (s == "resync")
+    return SlowConsumerPolicy::Resync;
+  else
+    throw std::invalid_argument(s);
+}
+
+std::atomic<size_t> Session::sessions_count{0};
+std::atomic<size_t> Session::slow_consumers{0};
+std::atomic<size_t> Session::dropped_inputs{0};
+std::atomic<size_t> Session::input_contentions{0};
+
+namespace {
+
+// client messages without the name of a Join, as a byte other than NO_INPUT
+uint8_t pack_input(const ClientMessage &client_message) {
+  if (std::holds_alternative<Join>(client_message.m))
+    return 1;
+  if (std::holds_alternative<PlaceBomb>(client_message.m))
+    return 2;
+  if (std::holds_alternative<PlaceBlock>(client_message.m))
+    return 3;
+  return uint8_t(4 + std::get<Move>(client_message.m).direction);
+}
+
+ClientMessage unpack_input(uint8_t packed) {
+  switch (packed) {
+  case 1:
+    return ClientMessage{Join{}};
+  case 2:
+    return ClientMessage{PlaceBomb{}};
+  case 3:
+    return ClientMessage{PlaceBlock{}};
+  default:
+    return ClientMessage{Move{Direction(packed - 4)}};
+  }
+}
+
+} // namespace
+
+Session::Session(std::unique_ptr<Transport> transport_, Room &room_,
+                 const ServerOptions &server_options_)
+    : transport(std::move(transport_)), room(room_),
+      server_options(server_options_),
+      remote_address(transport->remote_address()) {
+  ++sessions_count;
+}
+
+Session::~Session() { --sessions_count; }
+
+void Session::start() {
+  boost::asio::post(transport->get_executor(), [self = shared_from_this()] {
+    if (self->remote_address.empty()) {
+      self->close();
+      return;
+    }
+    self->room.join(self);
+    self->read();
+  });
+}
+
+void Session::send(shared_message_t message) {
+  boost::asio::post(transport->get_executor(), [self = shared_from_this(),
+                                                message = std::move(message)] {
+    if (self->closed || self->resyncing)
+      return;
+    const auto &options = self->server_options;
+    // a message is accepted into an empty queue even if it is too large
+    if (!self->write_queue.empty() &&
+        (self->write_queue.size() >= options.max_queued_messages ||
+         self->queued_bytes + message->size() > options.max_queued_bytes))
+      self->handle_slow_consumer();
+    else
+      self->enqueue(std::move(message));
+  });
+}
+
+void Session::catch_up(std::vector<shared_message_t> messages) {
+  boost::asio::post(
+      transport->get_executor(),
+      [self = shared_from_this(), messages = std::move(messages)] {
+        if (self->closed)
+          return;
+        self->resyncing = false;
+        for (const auto &message : messages)
+          self->enqueue(message);
+      });
+}
+
+void Session::enqueue(shared_message_t message) {
+  queued_bytes += message->size();
+  write_queue.emplace_back(std::move(message));
+  if (write_batch.empty())
+    write();
+}
+
+void Session::handle_slow_consumer() {
+  ++slow_consumers;
+  switch (server_options.slow_consumer_policy) {
+  case SlowConsumerPolicy::Drop:
+    close();
+    break;
+  case SlowConsumerPolicy::Resync:
+    // the messages being written may be partially written, the rest were
+    // never started
+    while (write_queue.size() > write_batch.size()) {
+      queued_bytes -= write_queue.back()->size();
+      write_queue.pop_back();
+    }
+    resyncing = true;
+    room.resync(shared_from_this());
+    break;
+  }
+}
+
+void Session::read() {
+  transport->async_read_some(
+      boost::asio::buffer(read_buffer),
+      [self = shared_from_this()](const boost::system::error_code &error,
+                                  size_t len) {
+        if (error)
+          self->close();
+        else
+          self->handle_read(len);
+      });
+}
+
+void Session::handle_read(size_t len) {
+  pending.insert(pending.end(), read_buffer.begin(),
+                 read_buffer.begin() + ptrdiff_t(len));
+  size_t consumed = 0;
+  for (;;) {
+    BufferReader reader(pending.data() + consumed, pending.size() - consumed);
+    try {
+      auto client_message = deserialize_client_message(reader);
+      consumed += reader.position();
+      metrics::add(metrics::Counter::MessagesDecoded);
+      store_input(client_message);
+      if (std::holds_alternative<Join>(client_message.m))
+        room.join_game(shared_from_this(),
+                       std::get<Join>(client_message.m).name);
+    } catch (const CouldNotDeserialize &) {
+      if (reader.is_exhausted())
+        break;
+      metrics::add(metrics::Counter::DeserializationFailures);
+      close();
+      return;
+    }
+  }
+  pending.erase(pending.begin(), pending.begin() + ptrdiff_t(consumed));
+  read();
+}
+
+void Session::store_input(const ClientMessage &client_message) {
+  auto packed = pack_input(client_message);
+  auto previous = input.load();
+  // fails only if the room took the previous action in the meantime
+  while (!input.compare_exchange_strong(previous, packed))
+    ++input_contentions;
+  if (previous != NO_INPUT)
+    ++dropped_inputs;
+}
+
+std::optional<ClientMessage> Session::take_input() {
+  auto packed = input.exchange(NO_INPUT);
+  if (packed == NO_INPUT)
+    return std::nullopt;
+  return unpack_input(packed);
+}
+
+// Writes a batch of queued messages with a single gathering system call,
+// unless the transport takes only a part of it.
+void Session::write() {
+  write_batch_bytes = 0;
+  written = 0;
+  for (const auto &message : write_queue) {
+    if (write_batch.size() == MAX_WRITE_BATCH_MESSAGES)
+      break;
+    // a batch has at least one message, even if it is too large
+    if (!write_batch.empty() && write_batch_bytes + message->size() >
+                                    server_options.max_write_batch_bytes)
+      break;
+    write_batch_bytes += message->size();
+    write_batch.emplace_back(message);
+  }
+  write_some();
+}
+
+void Session::write_some() {
+  transport->async_write_some(
+      write_batch, written,
+      [self = shared_from_this()](const boost::system::error_code &error,
+                                  size_t len) {
+        if (error || self->closed) {
+          self->close();
+          return;
+        }
+        metrics::add(metrics::Counter::Writes);
+        metrics::add(metrics::Counter::BytesSent, len);
+        self->written += len;
+        if (self->written < self->write_batch_bytes) {
+          self->write_some();
+          return;
+        }
+
+        metrics::add(metrics::Counter::MessagesSent, self->write_batch.size());
+        self->write_queue.erase(self->write_queue.begin(),
+                                self->write_queue.begin() +
+                                    ptrdiff_t(self->write_batch.size()));
+        self->queued_bytes -= self->write_batch_bytes;
+        self->write_batch.clear();
+        if (!self->write_queue.empty())
+          self->write();
+      });
+}
+
+void Session::close() {
+  if (closed)
+    return;
+  closed = true;
+  room.leave(shared_from_this());
+  transport->close();
+}
@@ -0,0 +1,111 @@
+#ifndef __SESSION_HPP
+#define __SESSION_HPP
+
+// boost/asio/awaitable.hpp uses std::exchange without including <utility>
+#include <utility>
+
+#include <array>
+#include <atomic>
+#include <boost/asio.hpp>
+#include <deque>
+#include <memory>
+#include <optional>
+
+#include "messages.hpp"
+#include "transport.hpp"
+
+struct ServerOptions;
+class Room;
+
+// What to do with a client whose queue of outgoing messages is full.
+enum class SlowConsumerPolicy {
+  // close the connection
+  Drop,
+  // drop the queued messages and relay the state of the room from scratch
+  Resync,
+};
+
+SlowConsumerPolicy parse_slow_consumer_policy(const std::string &s);
+
+// A connection of a client to a room. All operations on the transport run
+// asynchronously on its strand, so that a connection costs no thread of its
+// own.
+class Session : public std::enable_shared_from_this<Session> {
+public:
+  Session(std::unique_ptr<Transport> transport_, Room &room_,
+          const ServerOptions &server_options_);
+  ~Session();
+
+  // joins the room and starts listening for client messages
+  void start();
+
+  // queues a message to be written to the client, can be called from any
+  // thread; applies the slow consumer policy if the queue is full
+  void send(shared_message_t message);
+
+  // queues the messages that bring the client up to date with its room,
+  // regardless of the queue limits
+  void catch_up(std::vector<shared_message_t> messages);
+
+  // takes the latest action of the client, if the room has not taken it yet;
+  // wait-free, can be called from any thread
+  std::optional<ClientMessage> take_input();
+
+  const std::string &address() const { return remote_address; }
+
+  // number of open sessions in the process
+  static size_t count() { return sessions_count.load(); }
+
+  // number of times the slow consumer policy was applied in the process
+  static size_t slow_consumers_count() { return slow_consumers.load(); }
+
+  // number of actions overwritten by a later one before the room took them
+  static size_t dropped_inputs_count() { return dropped_inputs.load(); }
+
+  // number of times a client and its room accessed its action at once
+  static size_t input_contentions_count() { return input_contentions.load(); }
+
+private:
+  // client messages have at most 1 + 1 + 255 bytes
+  static constexpr size_t READ_BUFFER_SIZE = 512;
+  // asio passes at most 64 buffers to a single sendmsg
+  static constexpr size_t MAX_WRITE_BATCH_MESSAGES = 64;
+  static constexpr uint8_t NO_INPUT = 0;
+
+  static std::atomic<size_t> sessions_count;
+  static std::atomic<size_t> slow_consumers;
+  static std::atomic<size_t> dropped_inputs;
+  static std::atomic<size_t> input_contentions;
+
+  std::unique_ptr<Transport> transport;
+  Room &room;
+  const ServerOptions &server_options;
+  std::string remote_address;
+  std::array<uint8_t, READ_BUFFER_SIZE> read_buffer;
+  // bytes of a client message that has not arrived in full yet
+  message_t pending;
+  // the latest action of the client, written only by the session and taken
+  // by the room at turn boundaries, NO_INPUT if there is none
+  std::atomic<uint8_t> input{NO_INPUT};
+  // the first messages, the ones in write_batch, are being written
+  std::deque<shared_message_t> write_queue;
+  size_t queued_bytes = 0;
+  std::vector<shared_message_t> write_batch;
+  size_t write_batch_bytes = 0;
+  // bytes of the batch written so far
+  size_t written = 0;
+  // messages sent before the room relays its state again are dropped
+  bool resyncing = false;
+  bool closed = false;
+
+  void read();
+  void handle_read(size_t len);
+  void store_input(const ClientMessage &client_message);
+  void enqueue(shared_message_t message);
+  void handle_slow_consumer();
+  void write();
+  void write_some();
+  void close();
+};
+
+#endif // __SESSION_HPP
@@ -0,0 +1,44 @@
+#include <stdexcept>
+
+#include "tick_scheduler.hpp"
+
+OverrunPolicy parse_overrun_policy(const std::string &s) {
+  if (s == "catch-up")
+    return OverrunPolicy::CatchUp;
+  else if (s == "skip")
+    return OverrunPolicy::Skip;
+  else if (s == "stretch")
+    return OverrunPolicy::Stretch;
+  else
+    throw std::invalid_argument(s);
+}
+
+void TickScheduler::start() { next_deadline = clock::now() + period; }
+
+void TickScheduler::begin() {
+  tick_deadline = next_deadline;
+  tick_start = clock::now();
+}
+
+TickReport TickScheduler::finish() {
+  auto tick_end = clock::now();
+  TickReport report;
+  report.lateness = tick_start - tick_deadline;
+  report.duration = tick_end - tick_start;
+
+  next_deadline = tick_deadline + period;
+  report.overrun = tick_end > next_deadline;
+  if (report.overrun) {
+    switch (policy) {
+    case OverrunPolicy::CatchUp:
+      break;
+    case OverrunPolicy::Skip:
+      next_deadline += (tick_end - next_deadline) / period * period + period;
+      break;
+    case OverrunPolicy::Stretch:
+      next_deadline = tick_end + period;
+      break;
+    }
+  }
+  return report;
+}
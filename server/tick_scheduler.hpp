@@ -0,0 +1,57 @@
+#ifndef __TICK_SCHEDULER_HPP
+#define __TICK_SCHEDULER_HPP
+
+#include <chrono>
+#include <string>
+
+// What to do when a tick ends after the deadline of the next one.
+enum class OverrunPolicy {
+  // keep the schedule, run the missed ticks back to back until it is met
+  CatchUp,
+  // keep the schedule, drop the missed deadlines
+  Skip,
+  // shift the schedule, the next tick is due a period after the late one ends
+  Stretch,
+};
+
+OverrunPolicy parse_overrun_policy(const std::string &s);
+
+struct TickReport {
+  // how late the tick started with respect to its deadline
+  std::chrono::steady_clock::duration lateness;
+  // how long the tick took
+  std::chrono::steady_clock::duration duration;
+  // whether the tick ended after the deadline of the next one
+  bool overrun;
+};
+
+// Fixed-rate scheduling of ticks against absolute deadlines, so that the time
+// spent processing a tick does not make the period drift.
+class TickScheduler {
+public:
+  using clock = std::chrono::steady_clock;
+
+  TickScheduler(clock::duration period_, OverrunPolicy policy_)
+      : period(period_), policy(policy_) {}
+
+  // the first tick is due a period from now
+  void start();
+
+  clock::time_point deadline() const { return next_deadline; }
+
+  // marks the beginning of the next tick, once its deadline has been waited
+  // for (e.g. with a timer)
+  void begin();
+
+  // marks the end of the current tick and schedules the next one
+  TickReport finish();
+
+private:
+  clock::duration period;
+  OverrunPolicy policy;
+  clock::time_point next_deadline;
+  clock::time_point tick_deadline;
+  clock::time_point tick_start;
+};
+
+#endif // __TICK_SCHEDULER_HPP
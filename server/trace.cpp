@@ -0,0 +1,85 @@
+#include <array>
+#include <fstream>
+#include <iomanip>
+
+#include "trace.hpp"
+
+namespace trace {
+
+std::atomic<bool> enabled{false};
+
+namespace {
+
+// A slot of the ring buffer, guarded by its sequence number like a seqlock:
+// the number of the span plus one once it is written, 0 while it is being
+// written.
+struct Event {
+  std::atomic<uint64_t> sequence{0};
+  std::atomic<const char *> name{nullptr};
+  std::atomic<int64_t> start{0};
+  std::atomic<int64_t> duration{0};
+  std::atomic<uint32_t> thread{0};
+};
+
+std::array<Event, CAPACITY> events;
+std::atomic<uint64_t> next_event{0};
+std::atomic<uint32_t> next_thread{0};
+const clock::time_point epoch = clock::now();
+
+int64_t nanoseconds(clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+      .count();
+}
+
+uint32_t thread_id() {
+  thread_local uint32_t id = next_thread.fetch_add(1) + 1;
+  return id;
+}
+
+} // namespace
+
+void enable() { enabled = true; }
+
+void record(const char *name, clock::time_point start, clock::time_point end) {
+  auto i = next_event.fetch_add(1, std::memory_order_relaxed);
+  auto &event = events[i % CAPACITY];
+  event.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  event.name.store(name, std::memory_order_relaxed);
+  event.start.store(nanoseconds(start - epoch), std::memory_order_relaxed);
+  event.duration.store(nanoseconds(end - start), std::memory_order_relaxed);
+  event.thread.store(thread_id(), std::memory_order_relaxed);
+  event.sequence.store(i + 1, std::memory_order_release);
+}
+
+bool dump(const std::string &path) {
+  std::ofstream out(path, std::ios::trunc);
+  if (!out)
+    return false;
+  out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+  auto end = next_event.load(std::memory_order_acquire);
+  auto begin = end > CAPACITY ? end - CAPACITY : 0;
+  bool first = true;
+  for (auto i = begin; i < end; ++i) {
+    auto &event = events[i % CAPACITY];
+    auto sequence = event.sequence.load(std::memory_order_acquire);
+    const char *name = event.name.load(std::memory_order_relaxed);
+    auto start = event.start.load(std::memory_order_relaxed);
+    auto duration = event.duration.load(std::memory_order_relaxed);
+    auto thread = event.thread.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // skipping the spans being written or overwritten in the meantime
+    if (sequence != i + 1 ||
+        event.sequence.load(std::memory_order_relaxed) != sequence)
+      continue;
+    out << (first ? "" : ",") << "\n{\"name\":\"" << name
+        << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+        << ",\"ts\":" << double(start) / 1e3
+        << ",\"dur\":" << double(duration) / 1e3 << "}";
+    first = false;
+  }
+  out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+  return bool(out);
+}
+
+} // namespace trace
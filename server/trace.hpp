@@ -0,0 +1,63 @@
+#ifndef __TRACE_HPP
+#define __TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Spans of time spent in the phases of the server, recorded to a lock-free
+// ring buffer that keeps the latest ones and dumped as Chrome trace_event
+// JSON (chrome://tracing, Perfetto). Nothing is recorded until tracing is
+// enabled, and the spans are compiled out entirely unless ROBOTS_TRACING is
+// defined.
+namespace trace {
+
+using clock = std::chrono::steady_clock;
+
+// the ring buffer keeps this many latest spans
+constexpr size_t CAPACITY = 1 << 16;
+
+extern std::atomic<bool> enabled;
+
+void enable();
+
+// can be called from any thread
+void record(const char *name, clock::time_point start, clock::time_point end);
+
+// writes the spans in the buffer to a file, can be called while they are
+// recorded; returns false if the file cannot be written
+bool dump(const std::string &path);
+
+// Records the time from its construction to its destruction, name has to be
+// a string literal.
+class Span {
+public:
+  explicit Span(const char *name_) : name(name_) {
+    if (enabled.load(std::memory_order_relaxed))
+      start = clock::now();
+  }
+  ~Span() {
+    if (start != clock::time_point())
+      record(name, start, clock::now());
+  }
+
+  Span(const Span &) = delete;
+  Span &operator=(const Span &) = delete;
+
+private:
+  const char *name;
+  clock::time_point start{};
+};
+
+} // namespace trace
+
+#ifdef ROBOTS_TRACING
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SPAN(name) trace::Span TRACE_CONCAT(trace_span_, __LINE__)(name)
+#else
+#define TRACE_SPAN(name)
+#endif
+
+#endif // __TRACE_HPP
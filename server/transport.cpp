@@ -0,0 +1,32 @@
+#include <boost/lexical_cast.hpp>
+
+#include "transport.hpp"
+
+void unwritten_buffers(const std::vector<shared_message_t> &messages,
+                       size_t offset,
+                       std::vector<boost::asio::const_buffer> &buffers) {
+  buffers.clear();
+  for (const auto &message : messages) {
+    if (offset >= message->size()) {
+      offset -= message->size();
+      continue;
+    }
+    buffers.emplace_back(boost::asio::buffer(*message) + offset);
+    offset = 0;
+  }
+}
+
+std::string AsioTransport::remote_address() {
+  try {
+    return boost::lexical_cast<std::string>(socket.remote_endpoint());
+  } catch (...) {
+    return "";
+  }
+}
+
+void AsioTransport::async_write_some(
+    const std::vector<shared_message_t> &messages, size_t offset,
+    io_handler_t handler) {
+  unwritten_buffers(messages, offset, buffers);
+  socket.async_write_some(buffers, std::move(handler));
+}
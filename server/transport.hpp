@@ -0,0 +1,79 @@
+#ifndef __TRANSPORT_HPP
+#define __TRANSPORT_HPP
+
+// boost/asio/awaitable.hpp uses std::exchange without including <utility>
+#include <utility>
+
+#include <boost/asio.hpp>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "messages.hpp"
+
+// An encoded server message, shared by all the clients it is sent to.
+using shared_message_t = std::shared_ptr<const message_t>;
+
+using io_handler_t =
+    std::function<void(const boost::system::error_code &, size_t)>;
+
+// The connection of a session to its client. At most one read and one write
+// are pending at a time, and their handlers run on the executor of the
+// transport, which is a strand.
+class Transport {
+public:
+  virtual ~Transport() = default;
+
+  virtual boost::asio::any_io_executor get_executor() = 0;
+
+  // empty if the client is not connected anymore
+  virtual std::string remote_address() = 0;
+
+  virtual void async_read_some(boost::asio::mutable_buffer buffer,
+                               io_handler_t handler) = 0;
+
+  // writes some of the bytes of the messages, after the first offset ones
+  virtual void async_write_some(const std::vector<shared_message_t> &messages,
+                                size_t offset, io_handler_t handler) = 0;
+
+  // the pending operations complete with an error
+  virtual void close() = 0;
+};
+
+// A connection handled by the reactor of asio.
+class AsioTransport : public Transport {
+public:
+  explicit AsioTransport(boost::asio::ip::tcp::socket socket_)
+      : socket(std::move(socket_)) {}
+
+  boost::asio::any_io_executor get_executor() override {
+    return socket.get_executor();
+  }
+
+  std::string remote_address() override;
+
+  void async_read_some(boost::asio::mutable_buffer buffer,
+                       io_handler_t handler) override {
+    socket.async_read_some(buffer, std::move(handler));
+  }
+
+  void async_write_some(const std::vector<shared_message_t> &messages,
+                        size_t offset, io_handler_t handler) override;
+
+  void close() override {
+    boost::system::error_code ignored;
+    socket.close(ignored);
+  }
+
+private:
+  boost::asio::ip::tcp::socket socket;
+  std::vector<boost::asio::const_buffer> buffers;
+};
+
+// the parts of the messages after the first offset bytes
+void unwritten_buffers(const std::vector<shared_message_t> &messages,
+                       size_t offset,
+                       std::vector<boost::asio::const_buffer> &buffers);
+
+#endif // __TRANSPORT_HPP
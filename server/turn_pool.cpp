@@ -0,0 +1,66 @@
+#include <algorithm>
+
+#include "turn_pool.hpp"
+
+TurnPool::TurnPool(uint16_t threads) {
+  for (uint16_t i = 1; i < threads; ++i)
+    helpers.emplace_back([this] { help(); });
+}
+
+TurnPool::~TurnPool() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  job_added.notify_all();
+  for (auto &helper : helpers)
+    helper.join();
+}
+
+void TurnPool::run(size_t tasks, const std::function<void(size_t)> &task) {
+  if (helpers.empty() || tasks <= 1) {
+    for (size_t i = 0; i < tasks; ++i)
+      task(i);
+    return;
+  }
+
+  Job job{task, tasks};
+  {
+    std::lock_guard lock(mutex);
+    jobs.emplace_back(&job);
+  }
+  job_added.notify_all();
+  work(job);
+
+  // every task has been taken, the ones taken by the helpers may still run
+  std::unique_lock lock(mutex);
+  auto it = std::find(jobs.begin(), jobs.end(), &job);
+  if (it != jobs.end())
+    jobs.erase(it);
+  job_left.wait(lock, [&] { return job.helpers == 0; });
+}
+
+void TurnPool::help() {
+  std::unique_lock lock(mutex);
+  while (true) {
+    job_added.wait(lock, [this] { return stopping || !jobs.empty(); });
+    if (stopping)
+      return;
+    Job *job = jobs.front();
+    ++job->helpers;
+    lock.unlock();
+    work(*job);
+    lock.lock();
+    // the job has no tasks left, the other helpers need not look at it
+    if (!jobs.empty() && jobs.front() == job)
+      jobs.pop_front();
+    if (--job->helpers == 0)
+      job_left.notify_all();
+  }
+}
+
+void TurnPool::work(Job &job) {
+  for (size_t i = job.next.fetch_add(1, std::memory_order_relaxed);
+       i < job.tasks; i = job.next.fetch_add(1, std::memory_order_relaxed))
+    job.task(i);
+}
@@ -0,0 +1,51 @@
+#ifndef __TURN_POOL_HPP
+#define __TURN_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Helper threads that split the work of a turn with the thread playing it.
+// The calling thread works on its own job too, so a job never waits for a
+// free helper, and the rooms can share one pool.
+class TurnPool {
+public:
+  // threads, the calling one included
+  explicit TurnPool(uint16_t threads);
+  ~TurnPool();
+
+  TurnPool(const TurnPool &) = delete;
+  TurnPool &operator=(const TurnPool &) = delete;
+
+  size_t concurrency() const { return helpers.size() + 1; }
+
+  // calls task(i) for every i in [0, tasks) and returns when all the calls
+  // are done, can be called from many threads at once
+  void run(size_t tasks, const std::function<void(size_t)> &task);
+
+private:
+  struct Job {
+    const std::function<void(size_t)> &task;
+    size_t tasks;
+    std::atomic<size_t> next = 0;
+    // helpers working on the job
+    size_t helpers = 0;
+  };
+
+  std::mutex mutex;
+  std::condition_variable job_added;
+  std::condition_variable job_left;
+  // jobs with tasks that may not have been taken yet
+  std::deque<Job *> jobs;
+  bool stopping = false;
+  std::vector<std::thread> helpers;
+
+  void help();
+  static void work(Job &job);
+};
+
+#endif // __TURN_POOL_HPP
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+#include "uring.hpp"
+
+namespace {
+
+int io_uring_setup(unsigned entries, io_uring_params *params) {
+  return int(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                   unsigned flags) {
+  return int(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                     nullptr, 0));
+}
+
+int io_uring_register(int fd, unsigned opcode, const void *arg,
+                      unsigned nr_args) {
+  return int(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+template <typename T> T *at(void *ring, uint32_t offset) {
+  return reinterpret_cast<T *>(static_cast<char *>(ring) + offset);
+}
+
+} // namespace
+
+Uring::Descriptor::~Descriptor() {
+  if (fd >= 0)
+    close(fd);
+}
+
+Uring::Mapping::~Mapping() {
+  if (data)
+    munmap(data, size);
+}
+
+void Uring::Mapping::map(int fd, size_t size_, uint64_t offset) {
+  void *ret = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, off_t(offset));
+  if (ret == MAP_FAILED)
+    throw std::system_error(errno, std::system_category(), "mmap");
+  data = ret;
+  size = size_;
+}
+
+Uring::Uring(unsigned entries) : fd(io_uring_setup(entries, &params)) {
+  if (fd.get() < 0)
+    throw std::system_error(errno, std::system_category(), "io_uring_setup");
+
+  size_t sq_ring_size =
+      params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  size_t cq_ring_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  // older kernels map the rings separately
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    sq_ring.map(fd.get(), std::max(sq_ring_size, cq_ring_size),
+                IORING_OFF_SQ_RING);
+  } else {
+    sq_ring.map(fd.get(), sq_ring_size, IORING_OFF_SQ_RING);
+    cq_ring.map(fd.get(), cq_ring_size, IORING_OFF_CQ_RING);
+  }
+  sqes_ring.map(fd.get(), params.sq_entries * sizeof(io_uring_sqe),
+                IORING_OFF_SQES);
+
+  void *sq = sq_ring.get();
+  void *cq = cq_ring.get() ? cq_ring.get() : sq;
+  sq_head = at<uint32_t>(sq, params.sq_off.head);
+  sq_tail = at<uint32_t>(sq, params.sq_off.tail);
+  sq_mask = at<uint32_t>(sq, params.sq_off.ring_mask);
+  sq_array = at<uint32_t>(sq, params.sq_off.array);
+  cq_head = at<uint32_t>(cq, params.cq_off.head);
+  cq_tail = at<uint32_t>(cq, params.cq_off.tail);
+  cq_mask = at<uint32_t>(cq, params.cq_off.ring_mask);
+  cqes = at<io_uring_cqe>(cq, params.cq_off.cqes);
+  sqes = static_cast<io_uring_sqe *>(sqes_ring.get());
+}
+
+bool Uring::supported() {
+  io_uring_params params{};
+  int fd = io_uring_setup(2, &params);
+  if (fd < 0)
+    return false;
+  // the sockets are polled internally since 5.7, without it the operations
+  // would block the workers of the kernel
+  bool ret = params.features & IORING_FEAT_FAST_POLL;
+
+  std::vector<uint8_t> buffer(sizeof(io_uring_probe) +
+                              256 * sizeof(io_uring_probe_op));
+  auto *probe = reinterpret_cast<io_uring_probe *>(buffer.data());
+  if (io_uring_register(fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+    ret = false;
+  } else {
+    for (uint8_t op : {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG,
+                       IORING_OP_WRITE_FIXED, IORING_OP_READ}) {
+      if (op > probe->last_op ||
+          !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+        ret = false;
+    }
+  }
+  close(fd);
+  return ret;
+}
+
+io_uring_sqe *Uring::get_sqe() {
+  uint32_t head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+  uint32_t tail = *sq_tail + queued;
+  if (tail - head >= params.sq_entries)
+    return nullptr;
+  uint32_t index = tail & *sq_mask;
+  sq_array[index] = index;
+  ++queued;
+  auto *sqe = &sqes[index];
+  std::memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+Uring::Submitted Uring::submit(unsigned wait_for) {
+  __atomic_store_n(sq_tail, *sq_tail + queued, __ATOMIC_RELEASE);
+  unsubmitted += queued;
+  queued = 0;
+  // the kernel may take only some of the entries
+  do {
+    int ret = io_uring_enter(fd.get(), unsubmitted, wait_for,
+                             wait_for > 0 ? IORING_ENTER_GETEVENTS : 0);
+    if (ret < 0) {
+      if (errno == EINTR)
+        return Submitted::Interrupted;
+      if (errno == EBUSY || errno == EAGAIN)
+        return Submitted::Busy;
+      throw std::system_error(errno, std::system_category(),
+                              "io_uring_enter");
+    }
+    if (ret == 0 && unsubmitted > 0)
+      return Submitted::Busy;
+    unsubmitted -= uint32_t(ret);
+  } while (unsubmitted > 0);
+  return Submitted::All;
+}
+
+bool Uring::register_buffer_table(unsigned size) {
+  io_uring_rsrc_register table{};
+  table.nr = size;
+  table.flags = IORING_RSRC_REGISTER_SPARSE;
+  return io_uring_register(fd.get(), IORING_REGISTER_BUFFERS2, &table,
+                           sizeof(table)) == 0;
+}
+
+bool Uring::update_buffer(unsigned slot, const void *data, size_t size) {
+  iovec buffer{const_cast<void *>(data), size};
+  io_uring_rsrc_update2 update{};
+  update.offset = slot;
+  update.data = reinterpret_cast<uint64_t>(&buffer);
+  update.nr = 1;
+  return io_uring_register(fd.get(), IORING_REGISTER_BUFFERS_UPDATE, &update,
+                           sizeof(update)) == 1;
+}
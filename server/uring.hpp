@@ -0,0 +1,107 @@
+#ifndef __URING_HPP
+#define __URING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+
+// An io_uring instance set up with the raw system calls, with just what the
+// server needs: queueing submissions, reaping completions and a table of
+// registered buffers. Used by one thread at a time.
+class Uring {
+public:
+  // throws std::system_error if the kernel refuses
+  explicit Uring(unsigned entries);
+
+  Uring(const Uring &) = delete;
+  Uring &operator=(const Uring &) = delete;
+
+  // whether the kernel has io_uring with the operations the server uses
+  static bool supported();
+
+  // a zeroed entry to fill in, nullptr if the submission queue is full
+  io_uring_sqe *get_sqe();
+
+  enum class Submitted {
+    // all the entries, and the completions were waited for
+    All,
+    // a signal came before the completions
+    Interrupted,
+    // the completion queue is full, some entries are left until it is reaped
+    Busy,
+  };
+
+  // submits the queued entries and waits for at least wait_for completions
+  Submitted submit(unsigned wait_for);
+
+  // calls f(cqe) for every completion that has arrived; a completion is
+  // consumed before f is called, so f may reap the queue again
+  template <typename F> void for_each_completion(F f) {
+    uint32_t head = *cq_head;
+    while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+      io_uring_cqe cqe = cqes[head & *cq_mask];
+      __atomic_store_n(cq_head, ++head, __ATOMIC_RELEASE);
+      f(cqe);
+      head = *cq_head;
+    }
+  }
+
+  // an empty table of registered buffers, false if it is not supported
+  bool register_buffer_table(unsigned size);
+  // puts a buffer in a slot of the table, in place of the previous one
+  bool update_buffer(unsigned slot, const void *data, size_t size);
+
+private:
+  // closes the descriptor when destroyed
+  class Descriptor {
+  public:
+    explicit Descriptor(int fd_) : fd(fd_) {}
+    ~Descriptor();
+    Descriptor(const Descriptor &) = delete;
+    Descriptor &operator=(const Descriptor &) = delete;
+    int get() const { return fd; }
+
+  private:
+    int fd;
+  };
+
+  // a region of the ring mapped into memory, unmapped when destroyed
+  class Mapping {
+  public:
+    Mapping() = default;
+    ~Mapping();
+    Mapping(const Mapping &) = delete;
+    Mapping &operator=(const Mapping &) = delete;
+    // throws std::system_error if the region cannot be mapped
+    void map(int fd, size_t size, uint64_t offset);
+    void *get() const { return data; }
+
+  private:
+    void *data = nullptr;
+    size_t size = 0;
+  };
+
+  io_uring_params params{};
+  Descriptor fd;
+  Mapping sq_ring;
+  // empty if the rings are mapped together
+  Mapping cq_ring;
+  Mapping sqes_ring;
+
+  uint32_t *sq_head;
+  uint32_t *sq_tail;
+  uint32_t *sq_mask;
+  uint32_t *sq_array;
+  uint32_t *cq_head;
+  uint32_t *cq_tail;
+  uint32_t *cq_mask;
+  io_uring_cqe *cqes;
+  io_uring_sqe *sqes;
+
+  // entries queued since the last submission
+  uint32_t queued = 0;
+  // entries published to the kernel that it has not taken yet
+  uint32_t unsubmitted = 0;
+};
+
+#endif // __URING_HPP
@@ -0,0 +1,299 @@
+#include <boost/lexical_cast.hpp>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "uring_transport.hpp"
+
+struct UringLoop::Operation {
+  enum class Kind { Wake, Accept, Recv, Send };
+
+  Kind kind;
+  int fd = -1;
+  // the buffer of a recv
+  iovec buffer{};
+  // the unwritten parts of the messages of a send
+  std::vector<iovec> iovecs;
+  msghdr header{};
+  // the only message of a send with bytes left, with the offset of the first
+  // one
+  shared_message_t single;
+  size_t single_offset = 0;
+  // the registered buffer of a send, -1 if none
+  int slot = -1;
+  uint64_t wake_value = 0;
+  boost::asio::any_io_executor executor;
+  io_handler_t handler;
+};
+
+namespace {
+
+std::system_error system_error(const char *what) {
+  return std::system_error(errno, std::system_category(), what);
+}
+
+} // namespace
+
+UringLoop::UringLoop(boost::asio::io_context &io_context_)
+    : io_context(io_context_), ring(ENTRIES),
+      wake_operation(std::make_unique<Operation>()),
+      accept_operation(std::make_unique<Operation>()),
+      accept_strand(boost::asio::make_strand(io_context)) {
+  wake_fd = eventfd(0, EFD_CLOEXEC);
+  if (wake_fd < 0)
+    throw system_error("eventfd");
+  wake_operation->kind = Operation::Kind::Wake;
+  wake_operation->fd = wake_fd;
+  accept_operation->kind = Operation::Kind::Accept;
+  // without them, every message is sent with sendmsg
+  fixed_buffers = ring.register_buffer_table(REGISTERED_BUFFERS);
+  if (fixed_buffers)
+    slots.resize(REGISTERED_BUFFERS);
+  start(wake_operation.get());
+  thread = std::thread([this] { run(); });
+}
+
+UringLoop::~UringLoop() {
+  stopping = true;
+  notified = true;
+  uint64_t one = 1;
+  [[maybe_unused]] auto ignored = write(wake_fd, &one, sizeof(one));
+  thread.join();
+  if (listen_fd >= 0)
+    close(listen_fd);
+  close(wake_fd);
+}
+
+void UringLoop::listen(uint16_t port, bool reuse_port,
+                       std::function<void(int)> on_accept_) {
+  int fd = socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    throw system_error("socket");
+  int one = 1;
+  sockaddr_in6 address{};
+  address.sin6_family = AF_INET6;
+  address.sin6_addr = in6addr_any;
+  address.sin6_port = htons(port);
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+      (reuse_port &&
+       setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) ||
+      bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+      ::listen(fd, SOMAXCONN) < 0) {
+    auto error = system_error("bind");
+    close(fd);
+    throw error;
+  }
+  listen_fd = fd;
+  on_accept = std::move(on_accept_);
+  accept_operation->fd = fd;
+  submit(accept_operation.get());
+}
+
+void UringLoop::recv(int fd, boost::asio::mutable_buffer buffer,
+                     boost::asio::any_io_executor executor,
+                     io_handler_t handler) {
+  auto operation = std::make_unique<Operation>();
+  operation->kind = Operation::Kind::Recv;
+  operation->fd = fd;
+  operation->buffer = {buffer.data(), buffer.size()};
+  operation->executor = std::move(executor);
+  operation->handler = std::move(handler);
+  submit(operation.release());
+}
+
+void UringLoop::send(int fd, const std::vector<shared_message_t> &messages,
+                     size_t offset, boost::asio::any_io_executor executor,
+                     io_handler_t handler) {
+  auto operation = std::make_unique<Operation>();
+  operation->kind = Operation::Kind::Send;
+  operation->fd = fd;
+  for (const auto &message : messages) {
+    if (offset >= message->size()) {
+      offset -= message->size();
+      continue;
+    }
+    if (operation->iovecs.empty()) {
+      operation->single = message;
+      operation->single_offset = offset;
+    } else {
+      operation->single.reset();
+    }
+    operation->iovecs.push_back(
+        {const_cast<uint8_t *>(message->data()) + offset,
+         message->size() - offset});
+    offset = 0;
+  }
+  operation->header.msg_iov = operation->iovecs.data();
+  operation->header.msg_iovlen = operation->iovecs.size();
+  operation->executor = std::move(executor);
+  operation->handler = std::move(handler);
+  submit(operation.release());
+}
+
+void UringLoop::submit(Operation *operation) {
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    pending.emplace_back(operation);
+  }
+  wake();
+}
+
+void UringLoop::wake() {
+  if (notified.exchange(true))
+    return;
+  uint64_t one = 1;
+  [[maybe_unused]] auto ignored = write(wake_fd, &one, sizeof(one));
+}
+
+void UringLoop::run() {
+  std::vector<Operation *> started;
+  // the operations in flight when the loop stops are abandoned with the ring
+  while (!stopping) {
+    ring.submit(1);
+    reap();
+    {
+      std::lock_guard<std::mutex> lock(pending_mutex);
+      started.swap(pending);
+    }
+    for (auto *operation : started)
+      start(operation);
+    started.clear();
+  }
+}
+
+void UringLoop::reap() {
+  ring.for_each_completion([&](const io_uring_cqe &cqe) {
+    complete(reinterpret_cast<Operation *>(cqe.user_data), cqe.res);
+  });
+}
+
+io_uring_sqe *UringLoop::get_sqe() {
+  auto *sqe = ring.get_sqe();
+  while (!sqe) {
+    // the kernel takes no more entries until the completions are reaped
+    if (ring.submit(0) == Uring::Submitted::Busy)
+      reap();
+    sqe = ring.get_sqe();
+  }
+  return sqe;
+}
+
+void UringLoop::start(Operation *operation) {
+  auto *sqe = get_sqe();
+  sqe->fd = operation->fd;
+  sqe->user_data = reinterpret_cast<uint64_t>(operation);
+  switch (operation->kind) {
+  case Operation::Kind::Wake:
+    sqe->opcode = IORING_OP_READ;
+    sqe->addr = reinterpret_cast<uint64_t>(&operation->wake_value);
+    sqe->len = sizeof(operation->wake_value);
+    break;
+  case Operation::Kind::Accept:
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    break;
+  case Operation::Kind::Recv:
+    sqe->opcode = IORING_OP_RECV;
+    sqe->addr = reinterpret_cast<uint64_t>(operation->buffer.iov_base);
+    sqe->len = uint32_t(operation->buffer.iov_len);
+    break;
+  case Operation::Kind::Send:
+    if (operation->single && fixed_buffers)
+      operation->slot = acquire_slot(operation->single);
+    if (operation->slot >= 0) {
+      sqe->opcode = IORING_OP_WRITE_FIXED;
+      sqe->addr = reinterpret_cast<uint64_t>(operation->iovecs[0].iov_base);
+      sqe->len = uint32_t(operation->iovecs[0].iov_len);
+      sqe->buf_index = uint16_t(operation->slot);
+    } else {
+      sqe->opcode = IORING_OP_SENDMSG;
+      sqe->addr = reinterpret_cast<uint64_t>(&operation->header);
+      sqe->len = 1;
+      sqe->msg_flags = MSG_NOSIGNAL;
+    }
+    break;
+  }
+}
+
+void UringLoop::complete(Operation *operation, int res) {
+  switch (operation->kind) {
+  case Operation::Kind::Wake:
+    notified = false;
+    start(operation);
+    return;
+  case Operation::Kind::Accept:
+    if (res >= 0) {
+      int one = 1;
+      setsockopt(res, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      boost::asio::post(accept_strand, [this, fd = res] { on_accept(fd); });
+    }
+    start(operation);
+    return;
+  case Operation::Kind::Recv:
+  case Operation::Kind::Send:
+    break;
+  }
+
+  std::unique_ptr<Operation> owned(operation);
+  if (operation->slot >= 0)
+    --slots[size_t(operation->slot)].in_flight;
+  boost::system::error_code error;
+  size_t len = 0;
+  if (res < 0)
+    error = boost::system::error_code(-res, boost::system::system_category());
+  else if (res == 0 && operation->kind == Operation::Kind::Recv)
+    error = boost::asio::error::eof;
+  else
+    len = size_t(res);
+  boost::asio::post(operation->executor,
+                    [handler = std::move(operation->handler), error,
+                     len] { handler(error, len); });
+}
+
+// The least recently used slot without writes in flight is given to a
+// message that is not registered yet.
+int UringLoop::acquire_slot(const shared_message_t &message) {
+  auto it = slot_of.find(message.get());
+  if (it == slot_of.end()) {
+    int free_slot = -1;
+    for (size_t i = 0; i < slots.size(); ++i) {
+      if (slots[i].in_flight == 0 &&
+          (free_slot < 0 ||
+           slots[i].last_used < slots[size_t(free_slot)].last_used))
+        free_slot = int(i);
+    }
+    if (free_slot < 0)
+      return -1;
+    auto &slot = slots[size_t(free_slot)];
+    if (!ring.update_buffer(unsigned(free_slot), message->data(),
+                            message->size()))
+      return -1;
+    if (slot.message)
+      slot_of.erase(slot.message.get());
+    slot.message = message;
+    it = slot_of.emplace(message.get(), unsigned(free_slot)).first;
+  }
+  auto &slot = slots[it->second];
+  ++slot.in_flight;
+  slot.last_used = ++slot_clock;
+  return int(it->second);
+}
+
+UringTransport::~UringTransport() { ::close(fd); }
+
+std::string UringTransport::remote_address() {
+  boost::asio::ip::tcp::endpoint endpoint;
+  auto len = socklen_t(endpoint.capacity());
+  if (getpeername(fd, endpoint.data(), &len) < 0)
+    return "";
+  endpoint.resize(len);
+  try {
+    return boost::lexical_cast<std::string>(endpoint);
+  } catch (...) {
+    return "";
+  }
+}
+
+void UringTransport::close() { shutdown(fd, SHUT_RDWR); }
@@ -0,0 +1,126 @@
+#ifndef __URING_TRANSPORT_HPP
+#define __URING_TRANSPORT_HPP
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "transport.hpp"
+#include "uring.hpp"
+
+// Accepts the connections and runs the reads and writes of their transports
+// on an io_uring, from a thread of its own; the handlers are posted to the
+// io_context. A message sent on its own, as a broadcast turn usually is, is
+// written from a registered buffer: the latest messages are kept registered,
+// so that a turn sent to thousands of clients is mapped by the kernel once.
+class UringLoop {
+public:
+  // throws std::system_error if the ring cannot be set up
+  explicit UringLoop(boost::asio::io_context &io_context_);
+  ~UringLoop();
+
+  UringLoop(const UringLoop &) = delete;
+  UringLoop &operator=(const UringLoop &) = delete;
+
+  boost::asio::io_context &context() { return io_context; }
+
+  // accepts connections on a port of all interfaces, shared with the other
+  // loops if reuse_port; on_accept is called with every connected socket,
+  // one call at a time; throws std::system_error if the port cannot be bound
+  void listen(uint16_t port, bool reuse_port,
+              std::function<void(int)> on_accept);
+
+  void recv(int fd, boost::asio::mutable_buffer buffer,
+            boost::asio::any_io_executor executor, io_handler_t handler);
+
+  // writes some of the bytes of the messages, after the first offset ones
+  void send(int fd, const std::vector<shared_message_t> &messages,
+            size_t offset, boost::asio::any_io_executor executor,
+            io_handler_t handler);
+
+private:
+  struct Operation;
+
+  static constexpr unsigned ENTRIES = 4096;
+  static constexpr unsigned REGISTERED_BUFFERS = 64;
+
+  // a registered buffer holding a message
+  struct Slot {
+    shared_message_t message;
+    // writes from the buffer that have not completed yet
+    size_t in_flight = 0;
+    uint64_t last_used = 0;
+  };
+
+  boost::asio::io_context &io_context;
+  Uring ring;
+  int wake_fd = -1;
+  int listen_fd = -1;
+  std::unique_ptr<Operation> wake_operation;
+  std::unique_ptr<Operation> accept_operation;
+  boost::asio::strand<boost::asio::io_context::executor_type> accept_strand;
+  std::function<void(int)> on_accept;
+
+  // operations submitted by the other threads
+  std::mutex pending_mutex;
+  std::vector<Operation *> pending;
+  // whether the loop has been woken up since it last took the pending
+  // operations
+  std::atomic<bool> notified{false};
+  std::atomic<bool> stopping{false};
+
+  // owned by the loop
+  bool fixed_buffers;
+  std::vector<Slot> slots;
+  std::unordered_map<const message_t *, unsigned> slot_of;
+  uint64_t slot_clock = 0;
+
+  std::thread thread;
+
+  // the ring owns the operations until they complete
+  void submit(Operation *operation);
+  void wake();
+  void run();
+  // completes the operations that the kernel has finished
+  void reap();
+  io_uring_sqe *get_sqe();
+  void start(Operation *operation);
+  void complete(Operation *operation, int res);
+  // the slot of a registered buffer holding the message, -1 if none is free
+  int acquire_slot(const shared_message_t &message);
+};
+
+// A connection handled by an io_uring.
+class UringTransport : public Transport {
+public:
+  UringTransport(int fd_, UringLoop &loop_)
+      : fd(fd_), loop(loop_),
+        strand(boost::asio::make_strand(loop.context())) {}
+  ~UringTransport();
+
+  boost::asio::any_io_executor get_executor() override { return strand; }
+
+  std::string remote_address() override;
+
+  void async_read_some(boost::asio::mutable_buffer buffer,
+                       io_handler_t handler) override {
+    loop.recv(fd, buffer, strand, std::move(handler));
+  }
+
+  void async_write_some(const std::vector<shared_message_t> &messages,
+                        size_t offset, io_handler_t handler) override {
+    loop.send(fd, messages, offset, strand, std::move(handler));
+  }
+
+  // the descriptor is closed with the transport, when no operation can be
+  // pending anymore
+  void close() override;
+
+private:
+  int fd;
+  UringLoop &loop;
+  boost::asio::strand<boost::asio::io_context::executor_type> strand;
+};
+
+#endif // __URING_TRANSPORT_HPP